@@ -1,6 +1,7 @@
 // Generated by using Rcpp::compileAttributes() -> do not edit by hand
 // Generator token: 10BE3573-1514-4C36-9D1C-5A225CD40393
 
+#include "synder_types.h"
 #include <Rcpp.h>
 
 using namespace Rcpp;
@@ -85,6 +86,208 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// c_load_synmap
+Rcpp::XPtr<Synmap> c_load_synmap(std::string syn, std::string tcl, std::string qcl, bool swap, int k, double r, char trans, std::vector<int> offsets, int threads);
+RcppExport SEXP _synder_c_load_synmap(SEXP synSEXP, SEXP tclSEXP, SEXP qclSEXP, SEXP swapSEXP, SEXP kSEXP, SEXP rSEXP, SEXP transSEXP, SEXP offsetsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type syn(synSEXP);
+    Rcpp::traits::input_parameter< std::string >::type tcl(tclSEXP);
+    Rcpp::traits::input_parameter< std::string >::type qcl(qclSEXP);
+    Rcpp::traits::input_parameter< bool >::type swap(swapSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< double >::type r(rSEXP);
+    Rcpp::traits::input_parameter< char >::type trans(transSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type offsets(offsetsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_load_synmap(syn, tcl, qcl, swap, k, r, trans, offsets, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_load_synmap_df
+Rcpp::XPtr<Synmap> c_load_synmap_df(Rcpp::DataFrame syn, Rcpp::DataFrame tcl, Rcpp::DataFrame qcl, bool swap, int k, double r, char trans, std::vector<int> offsets, int threads);
+RcppExport SEXP _synder_c_load_synmap_df(SEXP synSEXP, SEXP tclSEXP, SEXP qclSEXP, SEXP swapSEXP, SEXP kSEXP, SEXP rSEXP, SEXP transSEXP, SEXP offsetsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type syn(synSEXP);
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type tcl(tclSEXP);
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type qcl(qclSEXP);
+    Rcpp::traits::input_parameter< bool >::type swap(swapSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< double >::type r(rSEXP);
+    Rcpp::traits::input_parameter< char >::type trans(transSEXP);
+    Rcpp::traits::input_parameter< std::vector<int> >::type offsets(offsetsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_load_synmap_df(syn, tcl, qcl, swap, k, r, trans, offsets, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_dump
+Rcpp::DataFrame c_handle_dump(Rcpp::XPtr<Synmap> synmap, bool reverse);
+RcppExport SEXP _synder_c_handle_dump(SEXP synmapSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_dump(synmap, reverse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_search
+Rcpp::DataFrame c_handle_search(Rcpp::XPtr<Synmap> synmap, Rcpp::DataFrame gff, bool reverse);
+RcppExport SEXP _synder_c_handle_search(SEXP synmapSEXP, SEXP gffSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type gff(gffSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_search(synmap, gff, reverse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_filter
+Rcpp::CharacterVector c_handle_filter(Rcpp::XPtr<Synmap> synmap, std::string hit, bool reverse);
+RcppExport SEXP _synder_c_handle_filter(SEXP synmapSEXP, SEXP hitSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< std::string >::type hit(hitSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_filter(synmap, hit, reverse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_map
+Rcpp::DataFrame c_handle_map(Rcpp::XPtr<Synmap> synmap, Rcpp::DataFrame gff, bool reverse);
+RcppExport SEXP _synder_c_handle_map(SEXP synmapSEXP, SEXP gffSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type gff(gffSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_map(synmap, gff, reverse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_count
+Rcpp::DataFrame c_handle_count(Rcpp::XPtr<Synmap> synmap, Rcpp::DataFrame gff, bool reverse);
+RcppExport SEXP _synder_c_handle_count(SEXP synmapSEXP, SEXP gffSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< Rcpp::DataFrame >::type gff(gffSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_count(synmap, gff, reverse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_load_cache
+Rcpp::XPtr<Synmap> c_load_cache(std::string cache, int threads);
+RcppExport SEXP _synder_c_load_cache(SEXP cacheSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type cache(cacheSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_load_cache(cache, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_write_cache
+void c_handle_write_cache(Rcpp::XPtr<Synmap> synmap, std::string cache);
+RcppExport SEXP _synder_c_handle_write_cache(SEXP synmapSEXP, SEXP cacheSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< std::string >::type cache(cacheSEXP);
+    c_handle_write_cache(synmap, cache);
+    return R_NilValue;
+END_RCPP
+}
+// c_handle_parameters
+Rcpp::List c_handle_parameters(Rcpp::XPtr<Synmap> synmap);
+RcppExport SEXP _synder_c_handle_parameters(SEXP synmapSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_parameters(synmap));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_reconfigure
+void c_handle_reconfigure(Rcpp::XPtr<Synmap> synmap, int k, double r, char trans);
+RcppExport SEXP _synder_c_handle_reconfigure(SEXP synmapSEXP, SEXP kSEXP, SEXP rSEXP, SEXP transSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< double >::type r(rSEXP);
+    Rcpp::traits::input_parameter< char >::type trans(transSEXP);
+    c_handle_reconfigure(synmap, k, r, trans);
+    return R_NilValue;
+END_RCPP
+}
+// c_handle_cursor
+Rcpp::XPtr<QueryCursor> c_handle_cursor(Rcpp::XPtr<Synmap> synmap, std::string gff, std::string command, int chunk_size, bool reverse);
+RcppExport SEXP _synder_c_handle_cursor(SEXP synmapSEXP, SEXP gffSEXP, SEXP commandSEXP, SEXP chunk_sizeSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< std::string >::type gff(gffSEXP);
+    Rcpp::traits::input_parameter< std::string >::type command(commandSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk_size(chunk_sizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_handle_cursor(synmap, gff, command, chunk_size, reverse));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_cursor_next
+Rcpp::DataFrame c_cursor_next(Rcpp::XPtr<QueryCursor> cursor);
+RcppExport SEXP _synder_c_cursor_next(SEXP cursorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<QueryCursor> >::type cursor(cursorSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_cursor_next(cursor));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_cursor_done
+bool c_cursor_done(Rcpp::XPtr<QueryCursor> cursor);
+RcppExport SEXP _synder_c_cursor_done(SEXP cursorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<QueryCursor> >::type cursor(cursorSEXP);
+    rcpp_result_gen = Rcpp::wrap(c_cursor_done(cursor));
+    return rcpp_result_gen;
+END_RCPP
+}
+// c_handle_write
+void c_handle_write(Rcpp::XPtr<Synmap> synmap, std::string gff, std::string out, std::string command, std::string format, int chunk_size, bool reverse);
+RcppExport SEXP _synder_c_handle_write(SEXP synmapSEXP, SEXP gffSEXP, SEXP outSEXP, SEXP commandSEXP, SEXP formatSEXP, SEXP chunk_sizeSEXP, SEXP reverseSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::XPtr<Synmap> >::type synmap(synmapSEXP);
+    Rcpp::traits::input_parameter< std::string >::type gff(gffSEXP);
+    Rcpp::traits::input_parameter< std::string >::type out(outSEXP);
+    Rcpp::traits::input_parameter< std::string >::type command(commandSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format(formatSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk_size(chunk_sizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type reverse(reverseSEXP);
+    c_handle_write(synmap, gff, out, command, format, chunk_size, reverse);
+    return R_NilValue;
+END_RCPP
+}
 
 static const R_CallMethodDef CallEntries[] = {
     {"_synder_c_dump", (DL_FUNC) &_synder_c_dump, 6},
@@ -92,6 +295,21 @@ static const R_CallMethodDef CallEntries[] = {
     {"_synder_c_filter", (DL_FUNC) &_synder_c_filter, 7},
     {"_synder_c_map", (DL_FUNC) &_synder_c_map, 4},
     {"_synder_c_count", (DL_FUNC) &_synder_c_count, 4},
+    {"_synder_c_load_synmap", (DL_FUNC) &_synder_c_load_synmap, 9},
+    {"_synder_c_load_synmap_df", (DL_FUNC) &_synder_c_load_synmap_df, 9},
+    {"_synder_c_handle_dump", (DL_FUNC) &_synder_c_handle_dump, 2},
+    {"_synder_c_handle_search", (DL_FUNC) &_synder_c_handle_search, 3},
+    {"_synder_c_handle_filter", (DL_FUNC) &_synder_c_handle_filter, 3},
+    {"_synder_c_handle_map", (DL_FUNC) &_synder_c_handle_map, 3},
+    {"_synder_c_handle_count", (DL_FUNC) &_synder_c_handle_count, 3},
+    {"_synder_c_load_cache", (DL_FUNC) &_synder_c_load_cache, 2},
+    {"_synder_c_handle_write_cache", (DL_FUNC) &_synder_c_handle_write_cache, 2},
+    {"_synder_c_handle_parameters", (DL_FUNC) &_synder_c_handle_parameters, 1},
+    {"_synder_c_handle_reconfigure", (DL_FUNC) &_synder_c_handle_reconfigure, 4},
+    {"_synder_c_handle_cursor", (DL_FUNC) &_synder_c_handle_cursor, 5},
+    {"_synder_c_cursor_next", (DL_FUNC) &_synder_c_cursor_next, 1},
+    {"_synder_c_cursor_done", (DL_FUNC) &_synder_c_cursor_done, 1},
+    {"_synder_c_handle_write", (DL_FUNC) &_synder_c_handle_write, 7},
     {NULL, NULL, 0}
 };
 
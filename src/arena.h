@@ -0,0 +1,97 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <new>
+#include <cstdint>
+
+/** A region allocator for objects that all die together
+ *
+ * Objects are constructed in place in large fixed size chunks and never move,
+ * so pointers to them stay valid until the arena is destroyed, which destroys
+ * every object and frees all chunks at once. Objects are numbered in the order
+ * they were made.
+ */
+template <class T>
+class Arena
+{
+private:
+    static const size_t CHUNK_BITS = 12;
+    static const size_t CHUNK_SIZE = (size_t) 1 << CHUNK_BITS;
+
+    // chunk storage, in allocation order
+    std::vector<T*> chunks;
+    // chunks sorted by address, with their position in chunks, for index_of
+    std::vector<std::pair<std::uintptr_t, size_t>> by_address;
+    size_t n = 0;
+
+    // no copies, the arena owns its objects
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+public:
+    Arena() { }
+
+    ~Arena() { clear(); }
+
+    /** Construct a new object at the end of the arena */
+    template <class... Args>
+    T* make(Args&&... args)
+    {
+        if (n == chunks.size() * CHUNK_SIZE) {
+            T* chunk = static_cast<T*>(::operator new(CHUNK_SIZE * sizeof(T)));
+            std::pair<std::uintptr_t, size_t> entry((std::uintptr_t) chunk, chunks.size());
+            by_address.insert(
+                std::upper_bound(by_address.begin(), by_address.end(), entry),
+                entry
+            );
+            chunks.push_back(chunk);
+        }
+        T* x = chunks[n >> CHUNK_BITS] + (n & (CHUNK_SIZE - 1));
+        new (x) T(std::forward<Args>(args)...);
+        n++;
+        return x;
+    }
+
+    size_t size() const { return n; }
+
+    /** The i-th object made */
+    T* at(size_t i) { return chunks[i >> CHUNK_BITS] + (i & (CHUNK_SIZE - 1)); }
+
+    /** The number of an object made by this arena */
+    size_t index_of(const T* x) const
+    {
+        auto it = std::upper_bound(
+            by_address.begin(),
+            by_address.end(),
+            std::pair<std::uintptr_t, size_t>((std::uintptr_t) x, (size_t) -1)
+        );
+        --it;
+        return (it->second << CHUNK_BITS) + (x - chunks[it->second]);
+    }
+
+    /** Destroy every object and free all memory */
+    void clear()
+    {
+        for (size_t i = 0; i < n; i++) {
+            at(i)->~T();
+        }
+        for (auto chunk : chunks) {
+            ::operator delete(chunk);
+        }
+        chunks.clear();
+        by_address.clear();
+        n = 0;
+    }
+
+    void swap(Arena& other)
+    {
+        chunks.swap(other.chunks);
+        by_address.swap(other.by_address);
+        std::swap(n, other.n);
+    }
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "block.h"
 
+#include <stdexcept>
+
 Block::Block()
 { }
 
@@ -27,15 +29,28 @@ void Block::unlink(Block* blk, int u, int d)
  *
  * i can be 0 or 1
  *
+ * Returns whether b took the place of a, the links are only updated if
+ * relink is set (see relink_edge_).
  */
-void Block::merge_block_a_into_b_edge_(Block* a, Block* b, int i)
+bool Block::merge_block_a_into_b_edge_(Block* a, Block* b, int i, bool relink)
 {
     // assert(i == 0 || i == 1);
+    bool move = REL_GE(a->pos[i], b->pos[i], i);
+    if (move) {
+        b->pos[i] = a->pos[i];
+    }
+    if (relink) {
+        relink_edge_(a, b, i, move);
+    }
+    return move;
+}
+
+void Block::relink_edge_(Block* a, Block* b, int i, bool move)
+{
     int u = 2 * i + i;
     int d = 2 * i + !i;
-    if (REL_GE(a->pos[i], b->pos[i], i)) {
+    if (move) {
         move_b_to_a(a, b, u, d);
-        b->pos[i] = a->pos[i];
     } else {
         dissolve_edge(a, u, d);
     }
@@ -69,10 +84,10 @@ void Block::move_b_to_a(Block* a, Block* b, int u, int d)
 }
 
 // NOTE: for debuging messages, look back to commit #eee599f4
-void Block::merge_block_a_into_b(Block* a, Block* b)
+void Block::merge_block_a_into_b(Block* a, Block* b, std::vector<Relink>* relinks)
 {
     if (!(a->overlap(b) && a->over->overlap(b->over))) {
-        Rcpp::stop(
+        throw std::runtime_error(
             "I shouldn't be here. Blocks are not doubly overlapping,"
             "I don't know how to merge them"
         );
@@ -81,20 +96,41 @@ void Block::merge_block_a_into_b(Block* a, Block* b)
     double olen = a->overlap_length(b);
     double al = a->pos[1] - a->pos[0] + 1;
     double bl = b->pos[1] - b->pos[0] + 1;
-    double score = ((al - olen) / (al)) * a->score +
-                   ((bl - olen) / (bl)) * b->score +
-                   std::max(a->score / al, b->score / bl) * olen;
+    double score = merge_score(a->score, b->score, al, bl, olen);
 
     b->score = score;
     b->over->score = score;
 
     merge_block_a_into_b_edge_(a, b, 0);
     merge_block_a_into_b_edge_(a, b, 1);
-    merge_block_a_into_b_edge_(a->over, b->over, 0);
-    merge_block_a_into_b_edge_(a->over, b->over, 1);
+    if (relinks == nullptr) {
+        merge_block_a_into_b_edge_(a->over, b->over, 0);
+        merge_block_a_into_b_edge_(a->over, b->over, 1);
+    } else {
+        Relink r;
+        r.a = a->over;
+        r.b = b->over;
+        r.merge = { a->id, b->id, al, bl, olen };
+        r.move[0] = merge_block_a_into_b_edge_(a->over, b->over, 0, false);
+        r.move[1] = merge_block_a_into_b_edge_(a->over, b->over, 1, false);
+        relinks->push_back(r);
+    }
 
     // Declare these blocks broken. A null `over` tags these blocks for
     // exclusion and will break asserts in Genome::validate
     a->over->over = nullptr;
     a->over = nullptr;
 }
+
+double Block::merge_score(double as, double bs, double al, double bl, double olen)
+{
+    return ((al - olen) / (al)) * as +
+           ((bl - olen) / (bl)) * bs +
+           std::max(as / al, bs / bl) * olen;
+}
+
+void Block::relink_homologs(const Relink& r)
+{
+    relink_edge_(r.a, r.b, 0, r.move[0]);
+    relink_edge_(r.a, r.b, 1, r.move[1]);
+}
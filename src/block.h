@@ -7,18 +7,55 @@
 #include "linked_interval.h"
 
 #include <array>
+#include <vector>
 
 class ContiguousSet;
+class Block;
+
+/** A merge of two blocks, as needed to recompute the merged score
+ *
+ * Merges only depend on positions, so replaying these records in order over
+ * new block scores gives the scores the merges would have produced.
+ */
+struct ScoreMerge
+{
+    // ids of the merged blocks, a was merged into b
+    size_t a;
+    size_t b;
+    // lengths of a and b, and of their overlap, when they were merged
+    double al;
+    double bl;
+    double olen;
+};
+
+/** The relinking of the homologs of two merged blocks, see merge_block_a_into_b
+ *
+ * Blocks of different query contigs may have homologs on the same target
+ * contig, so merges on the query contigs can only run in parallel if the
+ * target links are updated afterwards, in the same order as a serial merge.
+ */
+struct Relink
+{
+    Block* a;
+    Block* b;
+    // whether b took the place of a by start (0) and stop (1)
+    bool move[2];
+    // the merge itself, for Synmap::rescore_blocks
+    ScoreMerge merge;
+};
 
 class Block : public LinkedInterval<Block>, public Interval<Block>
 {
 friend class ManyBlocks;
+friend class SynmapCache;
+friend class Genome;
 private:
     static void unlink(Block* blk, int u, int d);
     static void move_b_to_a(Block* a, Block* b, int u, int d);
     static void replace_edge(Block* a, Block* b, int u, int d);
     static void dissolve_edge(Block* blk, int u, int d);
-    static void merge_block_a_into_b_edge_(Block* a, Block* b, int i);
+    static bool merge_block_a_into_b_edge_(Block* a, Block* b, int i, bool relink = true);
+    static void relink_edge_(Block* a, Block* b, int i, bool move);
 
 public:
     // adjacent block in contiguous set
@@ -45,8 +82,16 @@ public:
      *
      * @param a Block to be merged (and deleted)
      * @param b Block to hold the final union of a and b
+     * @param relinks if given, the homologs are merged but not relinked,
+     *        what is left to do is appended here for relink_homologs
      */
-    static void merge_block_a_into_b(Block* a, Block* b);
+    static void merge_block_a_into_b(Block* a, Block* b, std::vector<Relink>* relinks = nullptr);
+
+    /** Relink the homologs of a merge deferred by merge_block_a_into_b */
+    static void relink_homologs(const Relink& r);
+
+    /** Score of the union of blocks of scores as and bs, see ScoreMerge */
+    static double merge_score(double as, double bs, double al, double bl, double olen);
 };
 
 #endif
@@ -0,0 +1,143 @@
+#include "block_table.h"
+#include "genome.h"
+
+#include <algorithm>
+#include <cmath>
+
+const uint32_t BlockTable::NONE;
+
+template <class T>
+static uint32_t row_of(T* x)
+{
+    return x == nullptr ? BlockTable::NONE : x->row;
+}
+
+void BlockTable::build(Genome* query, Genome* target, double r)
+{
+    Genome* gen[2] = {query, target};
+
+    // number every block and set before any links are copied
+    size_t nblocks = 0, ncsets = 0, ncontigs = 0;
+    for (size_t g = 0; g < 2; g++) {
+        for (auto &pair : gen[g]->contig) {
+            Contig* con = pair.second;
+            for (auto &blk : con->block.inv) {
+                blk->row = nblocks++;
+            }
+            for (auto &c : con->cset.inv) {
+                c->row = ncsets++;
+            }
+            if (con->feat.name_id >= ncontigs) {
+                ncontigs = con->feat.name_id + 1;
+            }
+        }
+    }
+    if (nblocks >= NONE || ncsets >= NONE) {
+        Rcpp::stop("Too many blocks in the synteny map\n");
+    }
+
+    for (size_t i = 0; i < 2; i++) {
+        pos[i].clear();       pos[i].reserve(nblocks);
+        cnr[i].clear();       cnr[i].reserve(nblocks);
+        adj[i].clear();       adj[i].reserve(nblocks);
+        cset_pos[i].clear();  cset_pos[i].reserve(ncsets);
+        cset_ends[i].clear(); cset_ends[i].reserve(ncsets);
+    }
+    score.clear();   score.reserve(nblocks);
+    strand.clear();  strand.reserve(nblocks);
+    grpid.clear();   grpid.reserve(nblocks);
+    contig.clear();  contig.reserve(nblocks);
+    over.clear();    over.reserve(nblocks);
+    cset.clear();    cset.reserve(nblocks);
+    cset_id.clear(); cset_id.reserve(ncsets);
+    contig_length.assign(ncontigs, DEFAULT_CONTIG_LENGTH);
+
+    for (size_t g = 0; g < 2; g++) {
+        for (auto &pair : gen[g]->contig) {
+            Contig* con = pair.second;
+            contig_length[con->feat.name_id] = con->feat.parent_length;
+            for (auto &blk : con->block.inv) {
+                pos[0].push_back(blk->pos[0]);
+                pos[1].push_back(blk->pos[1]);
+                score.push_back(blk->score);
+                strand.push_back(blk->strand);
+                grpid.push_back(blk->grpid);
+                contig.push_back(blk->parent->name_id);
+                over.push_back(row_of(blk->over));
+                cset.push_back(row_of(blk->cset));
+                for (size_t i = 0; i < 2; i++) {
+                    cnr[i].push_back(row_of(blk->cnr[i]));
+                    adj[i].push_back(row_of(blk->corner_adj(i)));
+                }
+            }
+            for (auto &c : con->cset.inv) {
+                cset_id.push_back(c->id);
+                for (size_t i = 0; i < 2; i++) {
+                    cset_pos[i].push_back(c->pos[i]);
+                    cset_ends[i].push_back(row_of(c->ends[i]));
+                }
+            }
+        }
+    }
+
+    // members of each set, following the chain from its first block
+    cset_members.assign(1, 0);
+    member.clear();
+    for (size_t c = 0; c < cset_id.size(); c++) {
+        size_t first = member.size();
+        uint32_t b = cset_ends[0][c];
+        while (b != NONE && cnr[0][b] != NONE) {
+            b = cnr[0][b];
+        }
+        for (; b != NONE; b = cnr[1][b]) {
+            member.push_back(b);
+        }
+        std::sort(member.begin() + first, member.end(),
+            [&](uint32_t x, uint32_t y) { return pos[0][x] < pos[0][y]; }
+        );
+        cset_members.push_back(member.size());
+    }
+    for (size_t i = 0; i < 2; i++) {
+        member_pos[i].resize(member.size());
+        member_over_pos[i].resize(member.size());
+        for (size_t m = 0; m < member.size(); m++) {
+            member_pos[i][m] = pos[i][member[m]];
+            member_over_pos[i][m] = pos[i][over[member[m]]];
+        }
+    }
+
+    build_scores(r);
+}
+
+void BlockTable::build_scores(double r)
+{
+    score_r = r;
+    size_t n = member.size();
+    member_score.resize(n);
+    member_flank[0].resize(n);
+    member_flank[1].resize(n);
+
+    std::vector<double> v(n);
+    for (size_t m = 0; m < n; m++) {
+        long   b1 = member_pos[0][m];
+        long   b2 = member_pos[1][m];
+        double s  = score[member[m]];
+        v[m] = (r == 0) ? s : s / (b2 - b1 + 1) * -std::expm1(-r * (b2 - b1)) / r;
+    }
+
+    for (size_t c = 0; c + 1 < cset_members.size(); c++) {
+        uint32_t first = cset_members[c];
+        uint32_t last  = cset_members[c + 1];
+        for (uint32_t m = first; m < last; m++) {
+            bool head = m == first;
+            member_score[m] = score[member[m]] + (head ? 0 : member_score[m - 1]);
+            member_flank[0][m] = v[m] + (head ? 0 :
+                member_flank[0][m - 1] * std::exp(-r * (member_pos[1][m] - member_pos[1][m - 1])));
+        }
+        for (uint32_t m = last; m > first; m--) {
+            bool tail = m == last;
+            member_flank[1][m - 1] = v[m - 1] + (tail ? 0 :
+                member_flank[1][m] * std::exp(-r * (member_pos[0][m] - member_pos[0][m - 1])));
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef __BLOCK_TABLE_H__
+#define __BLOCK_TABLE_H__
+
+#include "global.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class Genome;
+
+/** A frozen structure-of-arrays copy of the blocks of a linked synteny map
+ *
+ * The Block objects are built for linking and carry many pointers, so
+ * searches that follow them touch a few cache lines per block. Once a map is
+ * complete its blocks and contiguous sets are copied here, each field into
+ * its own dense array, with links stored as 32-bit row numbers (NONE where
+ * the pointer is null). Rows number the blocks of both genomes, query first,
+ * and are recorded in each Block's and ContiguousSet's `row`.
+ */
+class BlockTable
+{
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    // per block
+    std::vector<long>     pos[2];    // start and stop
+    std::vector<double>   score;
+    std::vector<char>     strand;
+    std::vector<long>     grpid;
+    std::vector<uint32_t> contig;    // name id of the parent contig
+    std::vector<uint32_t> over;      // homologous block
+    std::vector<uint32_t> cnr[2];    // adjacent blocks in the contiguous set
+    std::vector<uint32_t> adj[2];    // adjacent non-overlapping blocks
+    std::vector<uint32_t> cset;      // contiguous set
+
+    // per contiguous set
+    std::vector<long>     cset_pos[2];
+    std::vector<size_t>   cset_id;
+    std::vector<uint32_t> cset_ends[2];
+    // members of set c, sorted by start, are member[cset_members[c]] up to
+    // member[cset_members[c + 1]]
+    std::vector<uint32_t> cset_members;
+
+    // per contiguous set member
+    std::vector<uint32_t> member;         // block row
+    std::vector<long>     member_pos[2];  // block start and stop
+    std::vector<long>     member_over_pos[2];  // homolog start and stop
+    // score sums for SearchInterval::calculate_score, see build_scores
+    double                score_r = 0;
+    std::vector<double>   member_score;   // scores of this and earlier members
+    std::vector<double>   member_flank[2];
+
+    // contig lengths by name id
+    std::vector<long>     contig_length;
+
+    /** Copy every block and contiguous set of a linked pair of genomes */
+    void build(Genome* query, Genome* target, double r);
+
+    /** Fill the score sums of the set members for decay rate r
+     *
+     * A member of score s at [b1, b2], on the far side of a query edge x,
+     * adds v * exp(-r * d) to the score of the query, where d is the distance
+     * from x to the member's near end and v = s/(b2-b1+1) * (1 - exp(-r*(b2-b1)))/r
+     * (or s if r is 0). Summing v exp(-r * d) for all members up to each one,
+     * with d measured from that member, lets the total for any edge past it
+     * be scaled from a single entry. member_flank[0] holds the sums over
+     * preceding members, anchored at each stop, member_flank[1] the sums over
+     * following members, anchored at each start. Every term only decays, so
+     * nothing overflows however far the members are from the contig start.
+     */
+    void build_scores(double r);
+
+    size_t size() const { return score.size(); }
+
+    /** Strand of the homolog of block b relative to b */
+    char over_strand(uint32_t b) const { return strand[b] == strand[over[b]] ? '+' : '-'; }
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "conflict_index.h"
+#include "genome.h"
+
+#include <algorithm>
+
+ConflictIndex::ConflictIndex(Genome* query, Genome* target)
+{
+    Genome* gen[2] = {query, target};
+    for (size_t g = 0; g < 2; g++) {
+        for (auto &pair : gen[g]->contig) {
+            Contig* con = pair.second;
+            slots[&con->feat].reset(new Slot(&con->block));
+        }
+    }
+}
+
+void ConflictIndex::Slot::build()
+{
+    // (homolog contig, start, stop) of every block
+    std::vector<std::pair<const Feature*, std::pair<long, long>>> rows;
+    rows.reserve(blocks->inv.size());
+    for (auto &blk : blocks->inv) {
+        rows.push_back(std::make_pair(blk->over->parent, std::make_pair(blk->pos[0], blk->pos[1])));
+    }
+    std::sort(rows.begin(), rows.end());
+
+    starts.resize(rows.size());
+    min_stop.resize(rows.size());
+    for (size_t i = rows.size(); i > 0; i--) {
+        const auto& row = rows[i - 1];
+        starts[i - 1] = row.second.first;
+        if (i == rows.size() || rows[i].first != row.first) {
+            min_stop[i - 1] = row.second.second;
+            groups[row.first].second = i;
+        } else {
+            min_stop[i - 1] = std::min(row.second.second, min_stop[i]);
+        }
+        groups[row.first].first = i - 1;
+    }
+}
+
+/* Determine if any non-overlapping target elements mapping to query exist
+ * between TARGET blocks a and b
+ *
+ * If any interval maps to a region in )a,b(, and to any region on the query, return false
+ *           a            z           b
+ *     T  <=====>       <===>      <=====>
+ *           |            |           |
+ *           |            |           |
+ *     Q  <=====>       <===>      <=====>
+ *                  **Conflict!**
+ *
+ *           a            z           b
+ *     T  <=====>       <===>      <=====>
+ *           |            \___________|_________
+ *           |                        |         \
+ *     Q  <=====>                  <=====>     <===>
+ *                                         **Conflict!**
+ *
+ *     Q2               <===>
+ *           a            |           b
+ *     T  <=====>       <===>      <=====>
+ *           |            z           |
+ *           |                        |
+ *     Q  <=====>                  <=====>
+ *                 **No Conflict**
+ *
+ * ???
+ *           a            z           b
+ *     T  <=====>       <===>      <=====>
+ *           |             \_______   |
+ *           |                     \  |
+ *     Q  <=====>                 <==>--->
+ *
+ * ???
+ *           a                        b
+ *     T  <=====>                 <==>--->
+ *           |             _______/   |
+ *           |            /           |
+ *     Q  <=====>      <===>      <======>
+ *                       z
+ *
+ * ???
+ *           a                        b
+ *     T  <=====>                 <======>   <===>
+ *           |             ___________|________/
+ *           |            /           |
+ *     Q  <=====>      <===>      <======>
+ *                       z
+ */
+bool ConflictIndex::conflict(Block* a, Block* b) const
+{
+    int up = (a->strand == '+') ? NEXT_START : PREV_STOP;
+    Block* x = a->corner(up);
+    for (size_t i = 0; i < WALK_LIMIT && x != nullptr; i++, x = x->corner(up)) {
+        if (x == b) {
+            return false;
+        }
+        if (
+            ! x->overlap(a) &&
+            ! x->overlap(b) &&
+            x->over->parent == a->over->parent
+        )
+            return true;
+    }
+    return indexed_conflict(a, b);
+}
+
+bool ConflictIndex::indexed_conflict(Block* a, Block* b) const
+{
+    auto s = slots.find(a->parent);
+    if (s == slots.end()) {
+        return false;
+    }
+    Slot* slot = s->second.get();
+    std::call_once(slot->built, [slot]() { slot->build(); });
+
+    auto it = slot->groups.find(a->over->parent);
+    if (it == slot->groups.end()) {
+        return false;
+    }
+
+    // the open gap between the blocks
+    long gap_start = std::min(a->pos[1], b->pos[1]);
+    long gap_stop  = std::max(a->pos[0], b->pos[0]);
+
+    auto first = slot->starts.begin() + it->second.first;
+    auto last  = slot->starts.begin() + it->second.second;
+    auto x = std::upper_bound(first, last, gap_start);
+    return x != last && slot->min_stop[x - slot->starts.begin()] < gap_stop;
+}
@@ -0,0 +1,60 @@
+#ifndef __CONFLICT_INDEX_H__
+#define __CONFLICT_INDEX_H__
+
+#include "block.h"
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <cstddef>
+
+class Genome;
+class ManyBlocks;
+
+/** Answers ContiguousSet conflict queries
+ *
+ * Two blocks a and b on one contig conflict if some block x lying strictly
+ * between them, overlapping neither, has its homolog on the same contig as
+ * the homolog of a. Such an x lies entirely within the gap between a and b.
+ *
+ * Most gaps hold a few blocks, and these are walked. Past WALK_LIMIT blocks,
+ * the blocks of the contig are indexed, on first use, by the contig of their
+ * homolog. Each group is sorted by start, with the least stop of each
+ * suffix, so the question is whether the first block starting after the gap
+ * opens has a suffix minimum stop before the gap closes.
+ */
+class ConflictIndex
+{
+private:
+    static const size_t WALK_LIMIT = 32;
+
+    // the index of the blocks of one contig
+    struct Slot
+    {
+        const ManyBlocks* blocks;
+        std::once_flag built;
+        // range of each homolog contig in starts and min_stop
+        std::unordered_map<const Feature*, std::pair<size_t, size_t>> groups;
+        std::vector<long> starts;
+        std::vector<long> min_stop;
+
+        Slot(const ManyBlocks* blocks) : blocks(blocks) { }
+
+        void build();
+    };
+
+    std::unordered_map<const Feature*, std::unique_ptr<Slot>> slots;
+
+    bool indexed_conflict(Block* a, Block* b) const;
+
+public:
+    /** Prepare to index the contigs of both genomes */
+    ConflictIndex(Genome* query, Genome* target);
+
+    /** Whether a block between a and b maps to the homolog contig of a */
+    bool conflict(Block* a, Block* b) const;
+};
+
+#endif
@@ -2,10 +2,12 @@
 
 Contig::Contig() { }
 
-Contig::Contig(const char* t_genome_name, const char* t_contig_name, long t_length)
+Contig::Contig(size_t t_contig_id, const char* t_contig_name, long t_length)
     :
-    feat(t_genome_name, 0, t_length, t_contig_name, t_length)
-{ }
+    feat(NameTable::NONE, 0, t_length, t_contig_name, t_length)
+{
+    feat.name_id = t_contig_id;
+}
 
 Contig::~Contig() { }
 
@@ -14,79 +16,95 @@ void Contig::set_length(long t_length)
     feat.parent_length = t_length;
 }
 
-void Contig::count(Feature& t_feat, CountType& df)
+void Contig::count(Feature& t_feat, ResultSink& df)
 {
     long count = block.count_overlaps(&t_feat);
 
     df.add_row(t_feat.name, count);
 }
 
-void Contig::map(Feature& t_feat, MapType& df)
+void Contig::map(Feature& t_feat, QueryScratch& scratch, ResultSink& df)
 {
-    auto rc = block.get_region(t_feat, true);
-    bool missing = rc->inbetween || rc->leftmost || rc->rightmost;
+    IntervalResult<Block>& rc = scratch.blocks;
+    block.sweep_region(t_feat, true, scratch.block_sweep, rc, scratch.block_tmp);
+    bool missing = rc.inbetween || rc.leftmost || rc.rightmost;
 
-    for (auto &qblk : rc->iv) {
+    for (auto &qblk : rc.iv) {
         if (qblk != nullptr) {
             df.add_row(
                 t_feat.name,
-                qblk->parent->name,
+                qblk->parent->name_id,
                 qblk->pos[0],
                 qblk->pos[1],
-                qblk->over->parent->name,
+                qblk->over->parent->name_id,
                 qblk->over->pos[0],
                 qblk->over->pos[1],
-                qblk->over->strand,
+                qblk->over_strand(),
                 missing
             );
         }
     }
-    delete rc;
 }
 
-std::vector<SearchInterval> Contig::list_search_intervals(Feature& t_feat, double r)
+void Contig::list_search_intervals(
+    Feature& t_feat,
+    double r,
+    const BlockTable& blocks,
+    QueryScratch& scratch
+)
 {
     // TODO -- need to move this back up to Contig
 
-    std::set<ContiguousSet*> csets;
+    std::vector<ContiguousSet*>& csets = scratch.hits;
+    csets.clear();
 
-    auto rc = block.get_region(t_feat, true);
+    IntervalResult<Block>& rc = scratch.blocks;
+    block.sweep_region(t_feat, true, scratch.block_sweep, rc, scratch.block_tmp);
 
     // get list of highest and lowest members of each contiguous set
-    for (auto &q : rc->iv) {
-        csets.insert(q->cset);
+    for (auto &q : rc.iv) {
+        csets.push_back(q->cset);
     }
 
     // TODO what am I doing here?
     // Merge all this crap into the SearchInterval class
-    auto crc = cset.get_region(t_feat, false);
-    if(! (crc->inbetween || crc->leftmost || crc->rightmost) ) {
-        for (auto &q : crc->iv) {
-            csets.insert(q);
+    IntervalResult<ContiguousSet>& crc = scratch.csets;
+    cset.sweep_region(t_feat, false, scratch.cset_sweep, crc, scratch.cset_tmp);
+    if(! (crc.inbetween || crc.leftmost || crc.rightmost) ) {
+        for (auto &q : crc.iv) {
+            csets.push_back(q);
         }
     }
 
+    // each set once, in order of id (sets are allocated concurrently when
+    // the map is linked on many threads, so their addresses are not ordered)
+    std::sort(csets.begin(), csets.end(), [](ContiguousSet* a, ContiguousSet* b) {
+        return a->id < b->id;
+    });
+    csets.erase(std::unique(csets.begin(), csets.end()), csets.end());
+
     // Iterate through each contiguous set, for each find the search interval
     // For each contiguous set, there is exactly one search interval
-    bool inbetween = rc->inbetween || rc->leftmost || rc->rightmost;
-    std::vector<SearchInterval> si;
+    bool inbetween = rc.inbetween || rc.leftmost || rc.rightmost;
+    scratch.si.clear();
     for(auto &c : csets) {
         // Build the search intervals
-        si.push_back( SearchInterval(c->ends, &t_feat, inbetween, r) );
+        scratch.si.push_back( SearchInterval(blocks, c->row, &t_feat, inbetween, r) );
     }
-
-    delete rc;
-    delete crc;
-
-    return si;
 }
 
-void Contig::find_search_intervals(Feature& t_feat, double r, SIType& stype)
+void Contig::find_search_intervals(
+    Feature& t_feat,
+    double r,
+    const BlockTable& blocks,
+    QueryScratch& scratch,
+    ResultSink& stype
+)
 {
     // find search intervals
-    std::vector<SearchInterval> si = list_search_intervals(t_feat, r);
+    list_search_intervals(t_feat, r, blocks, scratch);
     // store the results
-    for(auto &s : si) {
+    for(auto &s : scratch.si) {
         s.add_row(stype);
     }
 }
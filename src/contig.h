@@ -16,6 +16,28 @@
 #include <set>
 #include <Rcpp.h>
 
+/** Reusable buffers for queries against contigs
+ *
+ * Each caller (e.g. each thread) keeps one and passes it to every query. The
+ * buffers are cleared, not freed, between queries, so once they have grown
+ * no memory is allocated per feature.
+ */
+struct QueryScratch
+{
+    IntervalResult<Block>         blocks;
+    IntervalResult<ContiguousSet> csets;
+    // scratch space for IntervalSet::get_region
+    IntervalResult<Block>         block_tmp;
+    IntervalResult<ContiguousSet> cset_tmp;
+    // sweeps over the blocks and sets of the contig of the last query
+    SweepState<Block>             block_sweep;
+    SweepState<ContiguousSet>     cset_sweep;
+    // contiguous sets hit by a query
+    std::vector<ContiguousSet*>   hits;
+    // the search intervals of the last list_search_intervals call
+    std::vector<SearchInterval>   si;
+};
+
 class Contig {
 public:
     ManyBlocks block;
@@ -25,7 +47,7 @@ public:
     Contig();
 
     Contig(
-        const char* t_genome_name,
+        size_t      t_contig_id,
         const char* t_contig_name,
         long t_length=DEFAULT_CONTIG_LENGTH
     );
@@ -35,10 +57,21 @@ public:
     void set_length(long length);
 
     /** Print target regions from a given query */
-    void find_search_intervals(Feature& feat, double r, SIType& stype);
+    void find_search_intervals(
+        Feature& feat,
+        double r,
+        const BlockTable& blocks,
+        QueryScratch& scratch,
+        ResultSink& stype
+    );
 
-    /** Print target regions from a given query */
-    std::vector<SearchInterval> list_search_intervals(Feature& feat, double r);
+    /** Find the target regions of a given query, they are left in scratch.si */
+    void list_search_intervals(
+        Feature& feat,
+        double r,
+        const BlockTable& blocks,
+        QueryScratch& scratch
+    );
 
     /** Write blocks overlapping intervals in intfile
      *
@@ -48,13 +81,13 @@ public:
      * - target start position
      * - target stop position
      */
-    void map(Feature& feat, MapType& mtype);
+    void map(Feature& feat, QueryScratch& scratch, ResultSink& mtype);
 
     /** Count blocks overlapping intervals in intfile
      *
      * Prints the input sequence name and count to STDOUT in TAB-delimited format.
      */
-    void count(Feature& feat, CountType& df);
+    void count(Feature& feat, ResultSink& df);
 };
 
 #endif
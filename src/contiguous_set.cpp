@@ -65,7 +65,12 @@ bool ContiguousSet::strictly_forbidden(Block* a, Block* b, long k)
            (b->grpid - a->grpid) > (k+1);
 }
 
-bool ContiguousSet::are_contiguous(Block* blk_a, Block* blk_b, long k)
+bool ContiguousSet::are_contiguous(
+    Block* blk_a,
+    Block* blk_b,
+    long k,
+    const ConflictIndex& conflicts
+)
 {
     long qdiff, tdiff, demerits;
     char ats, bts;
@@ -117,11 +122,11 @@ bool ContiguousSet::are_contiguous(Block* blk_a, Block* blk_b, long k)
             (tdiff < 0 && bts == '-')
         ) &&
         // no cis jumpers
-        ! blocks_conflict(blk_a->over, blk_b->over) &&
-        ! blocks_conflict(blk_a, blk_b);
+        ! conflicts.conflict(blk_a->over, blk_b->over) &&
+        ! conflicts.conflict(blk_a, blk_b);
 }
 
-bool ContiguousSet::add_block(Block* blk_b, long k)
+bool ContiguousSet::add_block(Block* blk_b, long k, const ConflictIndex& conflicts)
 {
     // the latermost element in the ContiguousSet
     Block* blk_a;
@@ -135,7 +140,7 @@ bool ContiguousSet::add_block(Block* blk_b, long k)
 
     // Determine if the blocks are contiguous. Eventually I may implement a few
     // distinct contiguity functions.
-    may_add = are_contiguous(blk_a, blk_b, k);
+    may_add = are_contiguous(blk_a, blk_b, k, conflicts);
 
     if (may_add) {
         force_add_block(blk_b);
@@ -177,69 +182,3 @@ void ContiguousSet::add_side_(Block* b)
 
     size++;
 }
-
-/* Determine if any non-overlapping target elements mapping to query exist
- * between TARGET blocks a and b
- *
- * If any interval maps to a region in )a,b(, and to any region on the query, return false
- *           a            z           b
- *     T  <=====>       <===>      <=====>
- *           |            |           |
- *           |            |           |
- *     Q  <=====>       <===>      <=====>
- *                  **Conflict!**
- *
- *           a            z           b
- *     T  <=====>       <===>      <=====>
- *           |            \___________|_________
- *           |                        |         \
- *     Q  <=====>                  <=====>     <===>
- *                                         **Conflict!**
- *
- *     Q2               <===>
- *           a            |           b
- *     T  <=====>       <===>      <=====>
- *           |            z           |
- *           |                        |
- *     Q  <=====>                  <=====>
- *                 **No Conflict**
- *
- * ???
- *           a            z           b
- *     T  <=====>       <===>      <=====>
- *           |             \_______   |
- *           |                     \  |
- *     Q  <=====>                 <==>--->
- *
- * ???
- *           a                        b
- *     T  <=====>                 <==>--->
- *           |             _______/   |
- *           |            /           |
- *     Q  <=====>      <===>      <======>
- *                       z
- *
- * ???
- *           a                        b
- *     T  <=====>                 <======>   <===>
- *           |             ___________|________/
- *           |            /           |
- *     Q  <=====>      <===>      <======>
- *                       z
- */
-bool ContiguousSet::blocks_conflict(Block* a, Block* b)
-{
-    int up = (a->strand == '+') ? NEXT_START : PREV_STOP;
-    for (Block* x = a->corner(up); x != b; x = x->corner(up)) {
-        if (x == nullptr) {
-            throw "Foul magic in __func__:__LINE__";
-        }
-        if (
-            ! x->overlap(a) &&
-            ! x->overlap(b) &&
-            x->over->parent == a->over->parent
-        )
-            return true;
-    }
-    return false;
-}
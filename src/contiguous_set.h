@@ -7,6 +7,7 @@
 #include "linked_interval.h"
 #include "interval_tree.h"
 #include "block.h"
+#include "conflict_index.h"
 
 #include <array>
 #include <algorithm>
@@ -17,7 +18,6 @@ class ContiguousSet : public LinkedInterval<ContiguousSet>, public Interval<Cont
 {
 private:
     void add_side_(Block* blk);
-    bool blocks_conflict(Block* a, Block* b);
     void ContiguousSet_side_(Block* blk);
 
 public:
@@ -69,14 +69,17 @@ public:
      *   4. atc == btc
      *
      *   #1 will always be true, since strand is relative to query.
+     *
+     * Blocks between the two (on either genome) that map elsewhere on the
+     * same contig are looked up in conflicts.
      */
-    bool are_contiguous(Block* blk_a, Block* blk_b, long k);
+    bool are_contiguous(Block* blk_a, Block* blk_b, long k, const ConflictIndex& conflicts);
 
     /** Add a new block to the set if it is contiguous
      *
      * @return bool - true if block is contiguous and was added, false otherwise
      */
-    bool add_block(Block* blk, long k);
+    bool add_block(Block* blk, long k, const ConflictIndex& conflicts);
 
     /** Add a block without checking for contiguity */
     void force_add_block(Block* blk);
@@ -0,0 +1,61 @@
+#include "count_index.h"
+
+#include <algorithm>
+
+// fill eytz[k] for the subtree rooted at k with the next values of sorted
+static size_t fill(
+    const std::vector<long>& sorted,
+    std::vector<long>& eytz,
+    std::vector<uint32_t>& rank,
+    size_t i,
+    size_t k
+)
+{
+    if (k < eytz.size()) {
+        i = fill(sorted, eytz, rank, i, 2 * k);
+        eytz[k] = sorted[i];
+        rank[k] = i;
+        i++;
+        i = fill(sorted, eytz, rank, i, 2 * k + 1);
+    }
+    return i;
+}
+
+void CountIndex::layout(
+    std::vector<long> sorted,
+    std::vector<long>& eytz,
+    std::vector<uint32_t>& rank
+)
+{
+    std::sort(sorted.begin(), sorted.end());
+    eytz.assign(sorted.size() + 1, 0);
+    rank.assign(sorted.size() + 1, 0);
+    fill(sorted, eytz, rank, 0, 1);
+}
+
+CountIndex::CountIndex(const std::vector<long>& t_starts, const std::vector<long>& t_stops)
+{
+    layout(t_starts, starts, start_rank);
+    layout(t_stops, stops, stop_rank);
+}
+
+size_t CountIndex::count_less(
+    const std::vector<long>& eytz,
+    const std::vector<uint32_t>& rank,
+    long x
+)
+{
+    size_t n = eytz.size() - 1;
+    size_t k = 1;
+    // descend to a leaf, going right past values less than x
+    while (k <= n) {
+        k = 2 * k + (eytz[k] < x);
+    }
+    // the first value >= x is where the path last went left, found by
+    // dropping the trailing right turns and then that left turn
+    while (k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
+    return k == 0 ? n : rank[k];
+}
@@ -0,0 +1,56 @@
+#ifndef __COUNT_INDEX_H__
+#define __COUNT_INDEX_H__
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/** Counts the intervals overlapping a query in O(log n)
+ *
+ * An interval overlaps [a, b] iff it starts at or before b and does not stop
+ * before a, and every interval that stops before a also starts before b. So
+ * the overlap count is the number of starts <= b minus the number of stops
+ * < a, two rank queries on sorted arrays however many intervals overlap.
+ *
+ * The sorted starts and stops are stored in Eytzinger (BFS heap) order, so a
+ * search descends from the root with one comparison per level and the top
+ * levels of every search share the same few cache lines.
+ */
+class CountIndex
+{
+private:
+    // sorted coordinates in Eytzinger order, 1-based, with the rank of each
+    std::vector<long>     starts;
+    std::vector<uint32_t> start_rank;
+    std::vector<long>     stops;
+    std::vector<uint32_t> stop_rank;
+
+    static void layout(
+        std::vector<long> sorted,
+        std::vector<long>& eytz,
+        std::vector<uint32_t>& rank
+    );
+
+    // number of values less than x
+    static size_t count_less(
+        const std::vector<long>& eytz,
+        const std::vector<uint32_t>& rank,
+        long x
+    );
+
+public:
+    CountIndex() { }
+
+    /** Index intervals given by their start and stop positions */
+    CountIndex(const std::vector<long>& starts, const std::vector<long>& stops);
+
+    /** Number of intervals overlapping [a, b], inclusive */
+    size_t count(long a, long b) const
+    {
+        size_t n_started = count_less(starts, start_rank, b + 1);
+        size_t n_stopped = count_less(stops, stop_rank, a);
+        return n_started > n_stopped ? n_started - n_stopped : 0;
+    }
+};
+
+#endif
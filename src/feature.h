@@ -3,6 +3,7 @@
 
 #include "interval.h"
 #include "global.h"
+#include "name_table.h"
 
 #include <string>
 #include <iostream>
@@ -13,7 +14,9 @@ class Feature : public Interval<Feature>
 {
 public:
 
-    std::string parent_name = ".";
+    // contig names are interned, see NameTable
+    size_t parent_id        = NameTable::NONE; // id of the parent's name
+    size_t name_id          = NameTable::NONE; // id of the name (contigs only)
     std::string name        = ".";
     long parent_length      = DEFAULT_CONTIG_LENGTH;
     char strand             = '.';
@@ -21,17 +24,17 @@ public:
     Feature() { }
 
     Feature(
-        const char* t_parent_name,
+        size_t      t_parent_id,
         long        t_start,
         long        t_stop
     )
         :
         Interval(t_start, t_stop),
-        parent_name(t_parent_name)
+        parent_id(t_parent_id)
     { }
 
     Feature(
-        const char* t_parent_name,
+        size_t      t_parent_id,
         long        t_start,
         long        t_stop,
         const char* t_name,
@@ -40,7 +43,7 @@ public:
     )
         :
         Interval(t_start, t_stop),
-        parent_name(t_parent_name),
+        parent_id(t_parent_id),
         name(t_name),
         parent_length(t_parent_length),
         strand(t_strand)
@@ -50,7 +53,7 @@ public:
 
     bool feature_overlap(Feature* other)
     {
-        return overlap(other) && parent_name == other->parent_name;
+        return overlap(other) && parent_id == other->parent_id;
     }
 
 };
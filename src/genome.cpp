@@ -1,7 +1,10 @@
 #include "genome.h"
 
-Genome::Genome(std::string t_name)
-    : name(t_name)
+#include <functional>
+#include <mutex>
+
+Genome::Genome(std::string t_name, NameTable* t_names)
+    : name(t_name), names(t_names)
 { }
 
 Genome::~Genome()
@@ -13,43 +16,49 @@ Genome::~Genome()
 
 Contig* Genome::add_contig(std::string contig_name)
 {
-    Contig* con;
-    auto it = contig.find(contig_name.c_str());
-    if (it == contig.end()) {
-        con = new Contig(name.c_str(), contig_name.c_str());
-        contig[contig_name.c_str()] = con;
-    } else {
-        con = (*it).second;
+    return add_contig(contig_name.data(), contig_name.size());
+}
+
+Contig* Genome::add_contig(const char* contig_name, size_t length)
+{
+    size_t id = names->intern(contig_name, length);
+    if (id >= contig_by_id.size()) {
+        contig_by_id.resize(id + 1, nullptr);
+    }
+    Contig* con = contig_by_id[id];
+    if (con == nullptr) {
+        const std::string& s = names->name(id);
+        con = new Contig(id, s.c_str());
+        contig[s] = con;
+        contig_by_id[id] = con;
     }
     return con;
 }
 
 Contig* Genome::get_contig(std::string t_name)
 {
-    Contig* con;
-    try {
-        con = contig.at(t_name);
-    } catch (const std::out_of_range& e) {
-#ifdef DEGUB
-        // A contig may be present in an assembly but not represented in the
-        // synteny map so an attempt to access an element that doesn't exist
-        // should not raise an exception.
-        Rcpp::warning("Failed to access contig '" t_name "' in " genome.cpp "::get_contig");
-#endif
-        con = nullptr;
-    }
-    return con;
+    // A contig may be present in an assembly but not represented in the
+    // synteny map, so a missing contig is not an error.
+    return get_contig(names->find(t_name));
 }
 
 Block* Genome::add_block(std::string contig_name, long start, long stop, double score, char strand = '+')
 {
-    Contig* con = add_contig(contig_name.c_str());
+    return add_block(contig_name.data(), contig_name.size(), start, stop, score, strand);
+}
 
-    pool.push(
-        Block(start, stop, score, strand, &con->feat, pool.size() + 1)
-    );
+Block* Genome::add_block(
+    const char* contig_name,
+    size_t      contig_name_length,
+    long        start,
+    long        stop,
+    double      score,
+    char        strand
+)
+{
+    Contig* con = add_contig(contig_name, contig_name_length);
 
-    Block* blk_ptr = &pool.top();
+    Block* blk_ptr = pool.make(start, stop, score, strand, &con->feat, pool.size() + 1);
 
     con->block.add(blk_ptr);
 
@@ -58,35 +67,43 @@ Block* Genome::add_block(std::string contig_name, long start, long stop, double
 
 void Genome::set_contig_lengths(std::string clfile)
 {
-    std::ifstream fh(clfile); 
+    // contig lengths are optional, a missing file is silently ignored
+    if(LineReader::readable(clfile)) {
 
-    if(fh) {
+        LineReader fh(clfile);
 
         std::string contig_name;
         long contig_length;
 
-        std::string line;
-        while (std::getline(fh, line)) {
+        while (fh.next_line()) {
 
             // skip comments
-            if (line[0] == '#')
+            if (fh.is_comment())
                 continue;
 
-            std::stringstream row(line);
-
-            if (row >> contig_name >> contig_length) {
+            if (fh.read(contig_name) && fh.read(contig_length)) {
                 Contig* con = get_contig(contig_name);
 
                 if(con != nullptr) {
                     con->set_length(contig_length);
                 }
             } else {
-                Rcpp::warning("Failed to parse line:\n\t" + line);
+                Rcpp::warning("Failed to parse line:\n\t" + fh.line());
             }
         }
     }
 }
 
+void Genome::set_contig_lengths(const ContigLengths& lengths)
+{
+    for (auto &pair : lengths) {
+        Contig* con = get_contig(pair.first);
+        if (con != nullptr) {
+            con->set_length(pair.second);
+        }
+    }
+}
+
 Rcpp::DataFrame Genome::as_data_frame()
 {
     DumpType d;
@@ -94,71 +111,238 @@ Rcpp::DataFrame Genome::as_data_frame()
     for (auto &pair : contig) {
         for(Block* b = pair.second->block.front(); b != nullptr; b = b->next()){
             d.add_row(
-                b->parent->name,
+                b->parent->name_id,
                 b->pos[0],
                 b->pos[1],
-                b->over->parent->name,
+                b->over->parent->name_id,
                 b->over->pos[0],
                 b->over->pos[1],
                 b->score,
-                b->over->strand,
+                b->over_strand(),
                 b->cset->id
             );
         }
     }
 
-    return d.as_data_frame();
+    return d.as_data_frame(*names);
 }
 
-void Genome::link_block_corners()
+void Genome::link_block_corners(size_t threads)
 {
-    for (auto &pair : contig) {
-        pair.second->block.link_block_corners();
-    }
+    for_each_contig(threads, [](size_t, Contig* con) {
+        con->block.link_block_corners();
+    });
 }
 
-void Genome::set_contig_corners()
+void Genome::set_contig_corners(size_t threads)
 {
-    for (auto &pair : contig) {
-        pair.second->block.link_corners();
-    }
+    for_each_contig(threads, [](size_t, Contig* con) {
+        con->block.link_corners();
+    });
 }
 
-void Genome::set_overlap_group(long& offset)
+void Genome::set_overlap_group(long& offset, size_t threads)
 {
-    for (auto &pair : contig) {
-        pair.second->block.set_overlap_group(offset);
+    if (threads <= 1) {
+        for (auto &pair : contig) {
+            pair.second->block.set_overlap_group(offset);
+        }
+        return;
     }
+
+    // number the groups of each contig from 1, then shift them past the
+    // groups of the contigs before it
+    std::vector<long> ngroups(contig.size(), 0);
+    for_each_contig(threads, [&](size_t i, Contig* con) {
+        con->block.set_overlap_group(ngroups[i]);
+    });
+
+    std::vector<long> shift(contig.size());
+    for (size_t i = 0; i < shift.size(); i++) {
+        shift[i] = offset;
+        offset += ngroups[i];
+    }
+
+    for_each_contig(threads, [&](size_t i, Contig* con) {
+        for (auto &blk : con->block.inv) {
+            blk->grpid += shift[i];
+        }
+    });
 }
 
-void Genome::link_adjacent_blocks()
+std::vector< std::vector<size_t> > Genome::split_contigs(size_t threads)
 {
+    // Contigs are split into runs of about a quarter of a thread's share of
+    // the blocks, but no smaller than this
+    const size_t MIN_RUN = 1 << 12;
+
+    std::vector< std::vector<size_t> > bounds(contig.size());
+    if (threads <= 1) {
+        size_t i = 0;
+        for (auto &pair : contig) {
+            bounds[i++] = {0, pair.second->block.inv.size()};
+        }
+        return bounds;
+    }
+
+    size_t total = 0;
     for (auto &pair : contig) {
-        pair.second->block.link_adjacent_blocks();
+        total += pair.second->block.inv.size();
     }
+    size_t size = std::max(MIN_RUN, total / (4 * threads));
+    for_each_contig(threads, [&](size_t i, Contig* con) {
+        bounds[i] = con->block.split_groups(size);
+    });
+    return bounds;
 }
 
-void Genome::merge_overlaps()
+void Genome::link_adjacent_blocks(size_t threads)
 {
-    for (auto &pair : contig) {
-        pair.second->block.merge_overlaps();
+    std::vector< std::vector<size_t> > bounds = split_contigs(threads);
+    for_each_run(bounds, threads, [](size_t, Contig* con, size_t first, size_t last) {
+        con->block.link_adjacent_blocks(first, last);
+    });
+}
+
+void Genome::merge_overlaps(size_t threads, std::vector<ScoreMerge>* merges)
+{
+    // Runs of whole overlap groups are merged independently once the corners
+    // between them are cut, and stitched back together afterwards. The
+    // homologs of many runs may share a contig, so their links are updated
+    // last, in the order of a serial merge.
+    std::vector< std::vector<size_t> > bounds = split_contigs(threads);
+    size_t nruns = 0;
+    for (auto &b : bounds) {
+        nruns += b.size() - 1;
+    }
+
+    for_each_contig(threads, [&](size_t i, Contig* con) {
+        con->block.cut_seams(bounds[i]);
+    });
+
+    std::vector<std::vector<Relink>> relinks(nruns);
+    for_each_run(bounds, threads, [&](size_t j, Contig* con, size_t first, size_t last) {
+        con->block.merge_overlaps(first, last, &relinks[j]);
+    });
+
+    for_each_contig(threads, [&](size_t i, Contig* con) {
+        con->block.stitch_seams(bounds[i]);
+    });
+
+    for (auto &rs : relinks) {
+        for (auto &r : rs) {
+            Block::relink_homologs(r);
+            if (merges != nullptr) {
+                merges->push_back(r.merge);
+            }
+        }
     }
 }
 
-void Genome::refresh()
+void Genome::refresh(size_t threads)
 {
-    for (auto &pair : contig) {
-        pair.second->block.refresh();
+    for_each_contig(threads, [](size_t, Contig* con) {
+        con->block.refresh();
+    });
+}
+
+void Genome::compact_blocks(Genome* a, Genome* b)
+{
+    Genome* gen[2] = {a, b};
+    Arena<Block> packed[2];
+    // new location of each block of the old pools, nullptr for merged blocks
+    std::vector<Block*> moved[2];
+
+    for (size_t g = 0; g < 2; g++) {
+        moved[g].assign(gen[g]->pool.size(), nullptr);
+        for (auto &pair : gen[g]->contig) {
+            for (auto &blk : pair.second->block.inv) {
+                if (blk->cset != nullptr) {
+                    Rcpp::stop("Blocks must be compacted before contiguous sets are built\n");
+                }
+                moved[g][gen[g]->pool.index_of(blk)] = packed[g].make(*blk);
+            }
+        }
+    }
+
+    auto relocate = [&](size_t g, Block* blk) {
+        return blk == nullptr ? nullptr : moved[g][gen[g]->pool.index_of(blk)];
+    };
+
+    for (size_t g = 0; g < 2; g++) {
+        size_t h = !g;
+        for (size_t i = 0; i < packed[g].size(); i++) {
+            Block* blk = packed[g].at(i);
+            blk->over = relocate(h, blk->over);
+            for (size_t j = 0; j < 4; j++) {
+                blk->cor[j] = relocate(g, blk->cor[j]);
+            }
+            for (size_t j = 0; j < 2; j++) {
+                blk->adj[j] = relocate(g, blk->adj[j]);
+                blk->cnr[j] = relocate(g, blk->cnr[j]);
+            }
+        }
+        for (auto &pair : gen[g]->contig) {
+            ManyBlocks& block = pair.second->block;
+            for (auto &blk : block.inv) {
+                blk = relocate(g, blk);
+            }
+            for (size_t j = 0; j < 4; j++) {
+                block.set_corner(j, relocate(g, block.corner(j)));
+            }
+        }
+    }
+
+    // the old pools, merged blocks and all, are freed with packed
+    for (size_t g = 0; g < 2; g++) {
+        gen[g]->pool.swap(packed[g]);
     }
 }
 
-void Genome::link_contiguous_blocks(long k, size_t& setid)
+void Genome::link_contiguous_blocks(
+    long k,
+    size_t& setid,
+    const ConflictIndex& conflicts,
+    size_t threads
+)
 {
-    for (auto &pair : contig) {
-        Contig* con = pair.second;
+    if (threads <= 1) {
+        std::function<ContiguousSet*(Block*, size_t)> make_set = [&](Block* b, size_t id) {
+            return cset_pool.make(b, id);
+        };
+        for (auto &pair : contig) {
+            Contig* con = pair.second;
+            con->cset.link_contiguous_blocks(con->block.front(), k, setid, make_set, conflicts);
+        }
+        return;
+    }
+
+    // the pool is shared by all contigs
+    std::mutex pool_lock;
+    std::function<ContiguousSet*(Block*, size_t)> make_set = [&](Block* b, size_t id) {
+        std::lock_guard<std::mutex> guard(pool_lock);
+        return cset_pool.make(b, id);
+    };
+
+    // number the sets of each contig from 0, then shift them past the sets
+    // of the contigs before it
+    std::vector<size_t> nsets(contig.size(), 0);
+    for_each_contig(threads, [&](size_t i, Contig* con) {
         Block* first_blk = con->block.front();
-        con->cset.link_contiguous_blocks(first_blk, k, setid);
+        con->cset.link_contiguous_blocks(first_blk, k, nsets[i], make_set, conflicts);
+    });
+
+    std::vector<size_t> shift(contig.size());
+    for (size_t i = 0; i < shift.size(); i++) {
+        shift[i] = setid;
+        setid += nsets[i];
     }
+
+    for_each_contig(threads, [&](size_t i, Contig* con) {
+        for (auto &c : con->cset.inv) {
+            c->id += shift[i];
+        }
+    });
 }
 
 
@@ -167,31 +351,49 @@ void Genome::transfer_contiguous_sets(Genome* other){
         Contig* qcon = pair.second;
         for(auto &c : qcon->cset.inv){
             // for each ContiguousSet in each Contig, do:
-            Contig* tcon = other->get_contig(c->ends[0]->over->parent->name);
-            tcon->cset.add_from_homolog(c);
+            Contig* tcon = other->get_contig(c->ends[0]->over->parent->name_id);
+            tcon->cset.add_from_homolog(c, other->cset_pool);
         }
     }
 }
 
-void Genome::validate()
+void Genome::clear_contiguous_sets(size_t threads)
+{
+    for_each_contig(threads, [](size_t, Contig* con) {
+        con->cset.clear();
+        for (auto &blk : con->block.inv) {
+            blk->cset = nullptr;
+            blk->cnr  = {{ nullptr, nullptr }};
+        }
+    });
+    cset_pool.clear();
+}
+
+void Genome::set_scores(const std::vector<double>& score, size_t threads)
+{
+    for_each_contig(threads, [&](size_t, Contig* con) {
+        for (auto &blk : con->block.inv) {
+            blk->score = score[blk->id];
+            blk->over->score = blk->score;
+        }
+    });
+}
+
+void Genome::validate(size_t threads)
 {
     #define ASSERT_CON(t)                              \
             if(!(t)){                                  \
-              is_good=false;                           \
-              Rcpp::stop("Assert failed: `" #t "`\n"); \
+              return "Assert failed: `" #t "`\n";      \
             }
     #define ASSERT_BLK(t)                              \
             if(!(t)){                                  \
-              is_good=false;                           \
-              Rcpp::stop("Assert failed: `" #t "`\n"); \
+              return "Assert failed: `" #t "`\n";      \
             }
 
-        bool is_good = true;
-
-        for (auto &pair : contig)
+        // the first failed assertion on a contig, if any, counting the
+        // blocks that stop past its end
+        auto check = [](Contig* con, size_t& too_long) -> std::string
         {
-            Contig* con = pair.second;
-
             ASSERT_CON(con->block.corner(0) != nullptr);
             ASSERT_CON(con->block.corner(1) != nullptr);
             ASSERT_CON(con->block.corner(2) != nullptr);
@@ -202,7 +404,7 @@ void Genome::validate()
             {
 
                 if(blk->stop() > con->feat.parent_length){
-                    Rcpp::warning("Block stop is greater than contig length");
+                    too_long++;
                 }
 
                 ASSERT_BLK(blk->cset       != nullptr);
@@ -256,13 +458,45 @@ void Genome::validate()
                 }
 
             }
-        }
+            return "";
+        };
 
+        auto report = [](const std::string& failure, size_t too_long) {
+            for (size_t j = 0; j < too_long; j++) {
+                Rcpp::warning("Block stop is greater than contig length");
+            }
+            if (!failure.empty()) {
+                Rcpp::stop(failure);
+            }
+        };
 
-        if (! is_good){
-            throw "Synmap invariants did";
+        if (threads <= 1) {
+            for (auto &pair : contig) {
+                size_t too_long = 0;
+                std::string failure = check(pair.second, too_long);
+                report(failure, too_long);
+            }
+        } else {
+            // Contigs are checked in parallel, so failures and warnings are
+            // only recorded there and reported afterwards, in order of name
+            std::vector<std::string> failed(contig.size());
+            std::vector<size_t> too_long(contig.size(), 0);
+            for_each_contig(threads, [&](size_t c, Contig* con) {
+                failed[c] = check(con, too_long[c]);
+            });
+            for (size_t i = 0; i < failed.size(); i++) {
+                report(failed[i], too_long[i]);
+            }
         }
 
     #undef ASSERT_BLK
     #undef ASSERT_CON
 }
+
+void Genome::freeze(size_t threads)
+{
+    for_each_contig(threads, [](size_t, Contig* con) {
+        con->block.freeze();
+        con->cset.freeze();
+    });
+}
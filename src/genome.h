@@ -4,32 +4,137 @@
 #include "global.h"
 #include "contig.h"
 #include "many_contiguous_sets.h"
+#include "line_reader.h"
+#include "name_table.h"
+#include "arena.h"
+#include "parallel.h"
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <map>
-#include <stack>
 #include <Rcpp.h>
 
+/** Contig names and lengths, e.g. from a contig length file */
+typedef std::vector< std::pair<std::string, long> > ContigLengths;
+
 class Genome {
+friend class SynmapCache;
+friend class BlockTable;
+friend class ConflictIndex;
 private:
     std::string name;
+    // contig names, shared by both genomes of a Synmap
+    NameTable* names;
+    // contigs ordered by name
     std::map<std::string, Contig*> contig;
-    std::stack<Block> pool;
+    // contigs indexed by name id, nullptr for names from the other genome
+    std::vector<Contig*> contig_by_id;
+    // all blocks and contiguous sets of this genome, see compact_blocks
+    Arena<Block> pool;
+    Arena<ContiguousSet> cset_pool;
 
     Contig* add_contig(std::string contig_name);
 
+    Contig* add_contig(const char* contig_name, size_t length);
+
+    /** Call f(i, contig) for the i-th contig by name, on up to `threads` threads
+     *
+     * Contigs are handed out largest first, see parallel_for. With one
+     * thread they are visited in order of name.
+     */
+    template <class F>
+    void for_each_contig(size_t threads, F f)
+    {
+        if (threads <= 1) {
+            size_t i = 0;
+            for (auto &pair : contig) {
+                f(i++, pair.second);
+            }
+            return;
+        }
+        std::vector<Contig*> cons;
+        cons.reserve(contig.size());
+        for (auto &pair : contig) {
+            cons.push_back(pair.second);
+        }
+        std::vector<size_t> order(cons.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return cons[a]->block.inv.size() > cons[b]->block.inv.size();
+        });
+        parallel_for(order.size(), threads, [&](size_t j) {
+            f(order[j], cons[order[j]]);
+        });
+    }
+
+    /** Split large contigs into runs of whole overlap groups
+     *
+     * A contig is only split when there are threads to spare for it. Returns
+     * the runs of each contig by name, see ManyBlocks::split_groups.
+     */
+    std::vector< std::vector<size_t> > split_contigs(size_t threads);
+
+    /** Call f(j, contig, first, last) for the j-th run of split_contigs
+     *
+     * Runs are numbered over all contigs in order of name and handed out
+     * largest first, see parallel_for. With one thread they are visited in
+     * order.
+     */
+    template <class F>
+    void for_each_run(const std::vector< std::vector<size_t> >& bounds, size_t threads, F f)
+    {
+        if (threads <= 1) {
+            size_t i = 0, j = 0;
+            for (auto &pair : contig) {
+                for (size_t s = 1; s < bounds[i].size(); s++) {
+                    f(j++, pair.second, bounds[i][s - 1], bounds[i][s]);
+                }
+                i++;
+            }
+            return;
+        }
+
+        struct Run { Contig* con; size_t first; size_t last; };
+        std::vector<Run> runs;
+        size_t i = 0;
+        for (auto &pair : contig) {
+            for (size_t s = 1; s < bounds[i].size(); s++) {
+                runs.push_back({pair.second, bounds[i][s - 1], bounds[i][s]});
+            }
+            i++;
+        }
+        std::vector<size_t> order(runs.size());
+        for (size_t j = 0; j < order.size(); j++) {
+            order[j] = j;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return runs[a].last - runs[a].first > runs[b].last - runs[b].first;
+        });
+        parallel_for(order.size(), threads, [&](size_t j) {
+            const Run& run = runs[order[j]];
+            f(order[j], run.con, run.first, run.last);
+        });
+    }
+
 public:
 
-    Genome(std::string name);
+    Genome(std::string name, NameTable* names);
     ~Genome();
 
     Rcpp::DataFrame as_data_frame();
 
-    /** get contig by name, die if no matches */
+    /** get contig by name, nullptr if there is no such contig */
     Contig* get_contig(std::string contig_name);
 
+    /** get contig by name id, nullptr if there is no such contig */
+    Contig* get_contig(size_t contig_id)
+    {
+        return contig_id < contig_by_id.size() ? contig_by_id[contig_id] : nullptr;
+    }
+
     /** create a new Block, new contigs are created as needed */
     Block* add_block(
         std::string contig_name,
@@ -39,8 +144,20 @@ public:
         char        strand
     );
 
+    /** As above, for a name that is not null-terminated (e.g. a Field) */
+    Block* add_block(
+        const char* contig_name,
+        size_t      contig_name_length,
+        long        start,
+        long        stop,
+        double      score,
+        char        strand
+    );
+
     void set_contig_lengths(std::string clfile);
 
+    void set_contig_lengths(const ContigLengths& lengths);
+
     size_t size() {
         return contig.size();
     }
@@ -51,26 +168,61 @@ public:
 
     void dump_blocks();
 
+    // The build steps below work on each contig independently, on up to
+    // `threads` threads. The results do not depend on the number of threads.
+
     /** Link blocks by next and prev stop and next and prev start */
-    void link_block_corners();
+    void link_block_corners(size_t threads = 1);
 
     /** Link Contig to first and last blocks */
-    void set_contig_corners();
-
-    /** Set a unique index for each set of overlapping sequences */
-    void set_overlap_group(long& offset);
-
-    void link_adjacent_blocks();
+    void set_contig_corners(size_t threads = 1);
+
+    /** Set a unique index for each set of overlapping sequences
+     *
+     * Groups are numbered contig by contig in order of name, following offset.
+     */
+    void set_overlap_group(long& offset, size_t threads = 1);
+
+    void link_adjacent_blocks(size_t threads = 1);
+
+    /** Merge the blocks that overlap on both genomes
+     *
+     * If merges is given, a record of each merge is appended to it, in an
+     * order they can be replayed in (see ScoreMerge).
+     */
+    void merge_overlaps(size_t threads = 1, std::vector<ScoreMerge>* merges = nullptr);
+
+    void refresh(size_t threads = 1);
+
+    /** Pack the blocks left after merge_overlaps into fresh memory
+     *
+     * Merged blocks are left behind in the old pool and freed. The surviving
+     * blocks of both genomes are copied contiguously, contig by contig in
+     * order of start, and every link between blocks is redirected to the
+     * copies. Must be called before contiguous sets are built.
+     */
+    static void compact_blocks(Genome* a, Genome* b);
+
+    /** Build the contiguous sets, numbered contig by contig following setid */
+    void link_contiguous_blocks(
+        long k,
+        size_t& setid,
+        const ConflictIndex& conflicts,
+        size_t threads = 1
+    );
 
-    void merge_overlaps();
+    void transfer_contiguous_sets(Genome*);
 
-    void refresh();
+    /** Drop all contiguous sets, so the blocks can be chained anew */
+    void clear_contiguous_sets(size_t threads = 1);
 
-    void link_contiguous_blocks(long k, size_t& setid);
+    /** Set the score of each block, and its homolog, to score[id] */
+    void set_scores(const std::vector<double>& score, size_t threads = 1);
 
-    void transfer_contiguous_sets(Genome*);
+    void validate(size_t threads = 1);
 
-    void validate();
+    /** Build the query structures of every contig, see IntervalSet::freeze */
+    void freeze(size_t threads = 1);
 
 };
 
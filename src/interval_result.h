@@ -24,6 +24,16 @@ public:
 
     IntervalResult(){ };
     ~IntervalResult(){ }
+
+    /** Empty the result for reuse, keeping the memory of iv */
+    void clear()
+    {
+        iv.clear();
+        tree      = nullptr;
+        inbetween = false;
+        leftmost  = false;
+        rightmost = false;
+    }
 };
 
 #endif
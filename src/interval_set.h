@@ -5,58 +5,93 @@
 
 #include "global.h"
 #include "interval_tree.h"
+#include "count_index.h"
+#include "bound.h"
+
+template <class T> class IntervalSet;
+
+/** How far a sweep over an IntervalSet has got, see IntervalSet::sweep_region */
+template <class T>
+struct SweepState
+{
+    // the set being swept, nullptr while there is no window
+    const IntervalSet<T>* set = nullptr;
+    // set and start of the last query, swept or not
+    const IntervalSet<T>* last_set = nullptr;
+    long last_start = 0;
+    // queries on last_set in a row that came in order of start, and how many
+    // there must be before a window is started
+    size_t in_order = 0;
+    size_t wait = 0;
+    // the next interval, in order of start, to enter the window
+    size_t next = 0;
+    // intervals that have started and may still overlap later queries
+    std::vector<T*> active;
+};
 
 /** A container for LinkedIntervals */
 template <class T>
 class IntervalSet
 {
 private:
-    IntervalResult<T>* add_whatever_overlaps_flanks(IntervalResult<T>* res)
+    void add_whatever_overlaps_flanks(IntervalResult<T>& res, IntervalResult<T>& tmp)
     {
         // itree returns the flanks for queries that overlap nothing. However, I
         // need all the intervals that overlap these flanks as well.
-        IntervalResult<T>* tmp_a = nullptr;
-        IntervalResult<T>* tmp_b = nullptr;
-
-        if (res->inbetween) {
+        if (res.inbetween) {
             // If inbetween, itree should have returned the two flanking blocks
-            if (res->iv.size() == 2) {
-                tmp_a = res->tree->get_overlaps(res->iv[0]);
-                tmp_b = res->tree->get_overlaps(res->iv[1]);
-                res->iv.clear();
-                res->iv = tmp_a->iv;
-                res->iv.insert(
-                    res->iv.end(),
-                    tmp_b->iv.begin(),
-                    tmp_b->iv.end()
-                );
+            if (res.iv.size() == 2) {
+                T* flank_b = res.iv[1];
+                tree->get_overlaps(res.iv[0], tmp);
+                res.iv.assign(tmp.iv.begin(), tmp.iv.end());
+                tree->get_overlaps(flank_b, tmp);
+                res.iv.insert(res.iv.end(), tmp.iv.begin(), tmp.iv.end());
             } else {
                 throw "itree is broken, should return exactly 2 intervals for inbetween cases";
             }
-        } else if (res->leftmost || res->rightmost) {
-            if (res->iv.size() == 1) {
-                tmp_a = res->tree->get_overlaps(res->iv[0]);
-                res->iv = tmp_a->iv;
+        } else if (res.leftmost || res.rightmost) {
+            if (res.iv.size() == 1) {
+                tree->get_overlaps(res.iv[0], tmp);
+                res.iv.assign(tmp.iv.begin(), tmp.iv.end());
             } else {
                 throw "itree is broken, should return only 1 interval for left/rightmost cases";
             }
         }
-
-        delete tmp_a;
-        delete tmp_b;
-
-        return res;
     }
 
     void build_tree()
     {
         if (tree == nullptr) {
             tree = new IntervalTree<T>(inv);
+            by_start = inv;
+            std::stable_sort(by_start.begin(), by_start.end(), IntervalSet<T>::cmp_start);
+            start_pos.clear();
+            for (auto x : by_start) {
+                start_pos.push_back(x->pos[0]);
+            }
+        }
+    }
+
+    void build_counter()
+    {
+        if (counter == nullptr) {
+            std::vector<long> starts, stops;
+            starts.reserve(inv.size());
+            stops.reserve(inv.size());
+            for (auto x : inv) {
+                starts.push_back(x->pos[0]);
+                stops.push_back(x->pos[1]);
+            }
+            counter = new CountIndex(starts, stops);
         }
     }
 
 protected:
     IntervalTree<T>* tree = nullptr;
+    CountIndex* counter = nullptr;
+    // inv sorted by start, and the start positions, for sweeps
+    std::vector<T*> by_start;
+    std::vector<long> start_pos;
 
     static bool cmp_start         (T* a, T* b) { return ( a->pos[0] < b->pos[0] ); }
     static bool cmp_stop          (T* a, T* b) { return ( a->pos[1] < b->pos[1] ); }
@@ -72,6 +107,7 @@ public:
     virtual ~IntervalSet()
     {
         delete tree;
+        delete counter;
     }
 
     virtual T*     front() { return inv.front(); }
@@ -83,6 +119,11 @@ public:
     {
         inv.clear();
         delete tree;
+        tree = nullptr;
+        delete counter;
+        counter = nullptr;
+        by_start.clear();
+        start_pos.clear();
     }
 
     // wrapper for std::vector.push_back(T*)
@@ -135,36 +176,159 @@ public:
      * If there is only one flanking interval (i.e., the query is beyond any
      * syntenic interval), return just the nearest interval.
      *
+     * The result goes to res, tmp is scratch space. Both are cleared first,
+     * so reusing them across queries avoids any allocation once they have
+     * grown.
      */
     template<class U>
-    IntervalResult<T>* get_region(U& bound, bool get_flank_overlaps)
+    void get_region(
+        U& bound,
+        bool get_flank_overlaps,
+        IntervalResult<T>& res,
+        IntervalResult<T>& tmp
+    )
     {
         build_tree();
 
         // Search itree
-        IntervalResult<T>* res = tree->get_overlaps(&bound);
+        tree->get_overlaps(&bound, res);
 
         // I want everything that overlaps the flanks if I am doing a Block search.
         // For ContiguousSet searches, I currently only want overlapping intervals.
         // TODO find a better solution
         if (get_flank_overlaps) {
-            res = add_whatever_overlaps_flanks(res);
+            add_whatever_overlaps_flanks(res, tmp);
         }
+    }
 
-        return res;
+    /** As get_region, for queries that mostly come in order of start
+     *
+     * state keeps a window of the intervals that have started but not yet
+     * stopped as of the last query. While queries on the set come in order
+     * of start, each is answered by moving the window forward, so a sorted
+     * batch of queries costs one pass over the intervals instead of a tree
+     * descent per query. Queries that overlap nothing fall back to
+     * get_region, which finds the flanks.
+     *
+     * The window only pays while it stays small, so everything else goes
+     * to get_region too: queries that come out of order (and the first few
+     * in order after them, so unsorted input never starts a window) and
+     * queries that would grow the window past SWEEP_WINDOW intervals (long
+     * queries, or many long intervals). A window that grows too large is
+     * dropped, and the next one waits twice as long.
+     *
+     * The intervals returned are the same as from get_region, though
+     * overlapping intervals may come in a different order.
+     */
+    template<class U>
+    void sweep_region(
+        U& bound,
+        bool get_flank_overlaps,
+        SweepState<T>& state,
+        IntervalResult<T>& res,
+        IntervalResult<T>& tmp
+    )
+    {
+        // in order queries needed before the first window on a set
+        const size_t SWEEP_AFTER = 8;
+        // largest window worth keeping, a query overlapping more intervals
+        // than this costs no more through the tree
+        const size_t SWEEP_WINDOW = 32;
+
+        build_tree();
+
+        long a = bound.pos[0];
+        long b = bound.pos[1];
+
+        if (state.last_set != this) {
+            state.in_order = 0;
+            state.wait = SWEEP_AFTER;
+            state.set = nullptr;
+        } else if (a < state.last_start) {
+            state.in_order = 0;
+            state.set = nullptr;
+        } else {
+            state.in_order++;
+        }
+        state.last_set = this;
+        state.last_start = a;
+
+        if (state.set != this) {
+            if (state.in_order < state.wait) {
+                get_region(bound, get_flank_overlaps, res, tmp);
+                return;
+            }
+            // start the window with the intervals overlapping a
+            Bound pnt(a, a);
+            tree->get_overlaps(&pnt, tmp);
+            state.active.clear();
+            if (!(tmp.inbetween || tmp.leftmost || tmp.rightmost)) {
+                state.active.assign(tmp.iv.begin(), tmp.iv.end());
+            }
+            state.next = std::upper_bound(start_pos.begin(), start_pos.end(), a) - start_pos.begin();
+            state.set = this;
+        }
+
+        // intervals that stop before a overlap no later query either
+        size_t n = 0;
+        for (auto x : state.active) {
+            if (x->pos[1] >= a) {
+                state.active[n++] = x;
+            }
+        }
+        state.active.resize(n);
+
+        while (state.active.size() <= SWEEP_WINDOW && state.next < start_pos.size() && start_pos[state.next] <= b) {
+            T* x = by_start[state.next++];
+            if (x->pos[1] >= a) {
+                state.active.push_back(x);
+            }
+        }
+
+        if (state.active.size() > SWEEP_WINDOW) {
+            state.set = nullptr;
+            state.in_order = 0;
+            state.wait *= 2;
+            get_region(bound, get_flank_overlaps, res, tmp);
+            return;
+        }
+
+        res.clear();
+        res.tree = tree;
+        for (auto x : state.active) {
+            // the window may hold intervals that start after this query
+            if (x->pos[0] <= b) {
+                res.iv.push_back(x);
+            }
+        }
+
+        if (res.iv.empty()) {
+            get_region(bound, get_flank_overlaps, res, tmp);
+        }
+    }
+
+    /** Build the tree and counter now rather than on the first query
+     *
+     * Queries only read a frozen set, so they may run on many threads.
+     */
+    void freeze()
+    {
+        build_tree();
+        build_counter();
     }
 
+    /** Count the intervals overlapping u, in O(log n) (see CountIndex) */
     template<class U>
     long count_overlaps(U* u)
     {
-        build_tree();
-        return tree->count_overlaps(u);
+        build_counter();
+        return counter->count(u->pos[0], u->pos[1]);
     }
 
     long count_point_overlaps(long pnt)
     {
-        build_tree();
-        return tree->count_point_overlaps(pnt);
+        build_counter();
+        return counter->count(pnt, pnt);
     }
 };
 
@@ -2,28 +2,12 @@
 #define __INTERVAL_TREE_H__
 
 #include <array>
+#include <vector>
 #include <algorithm>
 
 #include "global.h"
 #include "interval_result.h"
 
-
-#define LAST_STOP(tree)   tree->by_stop.back()
-#define FIRST_START(tree) tree->by_start.front()
-
-#define T_SIZE(tree) tree->by_start.size()
-
-#define T_START(tree, i) tree->by_start[i]
-#define T_START_START(tree, i) tree->by_start[i]->pos[0]
-
-#define T_STOP(tree, i) tree->by_stop[i]
-#define T_STOP_STOP(tree, i) tree->by_stop[i]->pos[1]
-
-#define R_SIZE(result) result->iv.size()
-
-#define LEFT(tree) tree->children[0]
-#define RIGHT(tree) tree->children[1]
-
 typedef enum orientation {
     O_LEFT  = -1,
     O_ROOT  =  0,
@@ -31,92 +15,236 @@ typedef enum orientation {
     O_UNSET =  2
 } Orientation;
 
+/** A centered interval tree stored in flat arrays
+ *
+ * Nodes live in one vector, in preorder, and refer to each other by index.
+ * The intervals overlapping each node's center are stored contiguously in two
+ * arrays, one sorted by start and one by stop, next to parallel arrays of
+ * their start and stop positions. Scanning a node therefore reads positions
+ * from consecutive memory and only touches an interval when it is returned.
+ */
 template <class T>
 class IntervalTree
 {
 private:
+    // index of a missing node
+    static const long NIL = -1;
+
+    struct Node
+    {
+        // the center position for this node
+        long center;
+        // range of this node's intervals in by_start/by_stop
+        size_t begin;
+        size_t end;
+        long children[2];
+        long parent;
+        // position relative to parent
+        Orientation orientation;
+    };
+
+    std::vector<Node> nodes;
+    // intervals that overlap each center, sorted by start position per node
+    std::vector<T*>   by_start;
+    std::vector<long> start_pos;
+    // intervals that overlap each center, sorted by stop position per node
+    std::vector<T*>   by_stop;
+    std::vector<long> stop_pos;
 
     static bool cmp_start (T* a, T* b) { return ( a->pos[0] < b->pos[0] ); }
     static bool cmp_stop  (T* a, T* b) { return ( a->pos[1] < b->pos[1] ); }
 
-    /*
-     * Select a point at the center of the middle interval.
-     * This guarantees at least one interval overlaps each node.
-     * If the intervals are sorted, it also favors (but doesn't guarantee) a
-     * balanced tree.
+    /** Add the node for a range of intervals and, recursively, its children
+     *
+     * The range [first, last) of idx (indices into intervals) is partitioned in
+     * place, keeping the input order within each part, into the intervals
+     * left of the center, those overlapping it and those right of it. Only
+     * the node of each interval is recorded here, build_arrays fills in the
+     * sorted arrays afterwards. Returns the index of the new node.
      */
-    long get_center(std::vector<T*> v)
+    long build(
+        const std::vector<T*>& intervals,
+        std::vector<size_t>& idx,
+        std::vector<size_t>& scratch,
+        std::vector<long>& node_of,
+        size_t first,
+        size_t last,
+        long parent,
+        Orientation orientation
+    )
     {
-        // get the central index
-        long i = v.size() / 2;
-        // get the center point on this index
-        long x = (STOP(v[i]) - START(v[i])) / 2 + START(v[i]);
-        return x;
+        long id = nodes.size();
+        nodes.push_back(Node());
+
+        // Select a point at the center of the middle interval.
+        // This guarantees at least one interval overlaps each node.
+        // If the intervals are sorted, it also favors (but doesn't guarantee)
+        // a balanced tree.
+        T* mid = intervals[idx[first + (last - first) / 2]];
+        long center = (STOP(mid) - START(mid)) / 2 + START(mid);
+
+        nodes[id].center      = center;
+        nodes[id].parent      = parent;
+        nodes[id].orientation = orientation;
+
+        size_t nleft = 0, nhere = 0;
+        for (size_t i = first; i < last; i++) {
+            switch(intervals[idx[i]]->position_relative_to(center)) {
+                case hi:
+                    nleft++;
+                    break;
+                case in:
+                    nhere++;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        size_t l = first, h = first + nleft, r = first + nleft + nhere;
+        for (size_t i = first; i < last; i++) {
+            switch(intervals[idx[i]]->position_relative_to(center)) {
+                case hi:
+                    scratch[l++] = idx[i];
+                    break;
+                case in:
+                    node_of[idx[i]] = id;
+                    scratch[h++] = idx[i];
+                    break;
+                default:
+                    scratch[r++] = idx[i];
+            }
+        }
+        std::copy(scratch.begin() + first, scratch.begin() + last, idx.begin() + first);
+
+        // the intervals of each node are counted here, the ranges are set once
+        // the tree is complete
+        nodes[id].begin = nhere;
+
+        long left  = nleft == 0 ? NIL :
+            build(intervals, idx, scratch, node_of, first, first + nleft, id, O_LEFT);
+        long right = first + nleft + nhere == last ? NIL :
+            build(intervals, idx, scratch, node_of, first + nleft + nhere, last, id, O_RIGHT);
+        nodes[id].children[0] = left;
+        nodes[id].children[1] = right;
+
+        return id;
+    }
+
+    /** Fill the per node sorted arrays from a single sort of all intervals */
+    void build_arrays(const std::vector<T*>& intervals, const std::vector<long>& node_of)
+    {
+        size_t n = intervals.size();
+
+        // turn the counts into ranges, nodes are laid out in preorder
+        size_t offset = 0;
+        for (auto& node : nodes) {
+            size_t count = node.begin;
+            node.begin = offset;
+            node.end   = offset;
+            offset += count;
+        }
+
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+
+        by_start.resize(n);
+        start_pos.resize(n);
+        std::stable_sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return cmp_start(intervals[a], intervals[b]); }
+        );
+        for (auto i : order) {
+            size_t j = nodes[node_of[i]].end++;
+            by_start[j]  = intervals[i];
+            start_pos[j] = intervals[i]->pos[0];
+        }
+
+        for (auto& node : nodes) {
+            node.end = node.begin;
+        }
+
+        by_stop.resize(n);
+        stop_pos.resize(n);
+        std::stable_sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return cmp_stop(intervals[a], intervals[b]); }
+        );
+        for (auto i : order) {
+            size_t j = nodes[node_of[i]].end++;
+            by_stop[j]  = intervals[i];
+            stop_pos[j] = intervals[i]->pos[1];
+        }
     }
 
     /** Count the number of query-side intervals that overlap a search interval
      *
      * @param interval an interval on the IntervalTree
-     * @param tree an IntervalTree
+     * @param node index of a node in the tree
      */
     template <class U>
-    long count_overlaps(U* inv, IntervalTree<T>* tree, long count)
+    long count_overlaps(U* inv, long node, long count)
     {
-        if (tree == nullptr)
-            return count;
-        switch (inv->position_relative_to(tree->center)) {
-            case lo:
-                for (long long i = T_SIZE(tree) - 1; i >= 0 ; i--) {
-                    if (START(inv) <= T_STOP_STOP(tree, i)) {
-                        count++;
-                    } else {
-                        break;
+        while (node != NIL) {
+            const Node& n = nodes[node];
+            switch (inv->position_relative_to(n.center)) {
+                case lo:
+                    for (size_t i = n.end; i > n.begin; i--) {
+                        if (START(inv) <= stop_pos[i - 1]) {
+                            count++;
+                        } else {
+                            break;
+                        }
                     }
-                }
-                return count_overlaps(inv, RIGHT(tree), count);
-            case hi:
-                for (size_t i = 0; i < T_SIZE(tree); i++) {
-                    if (STOP(inv) >= T_START_START(tree, i)) {
-                        count++;
-                    } else {
-                        break;
+                    node = n.children[1];
+                    break;
+                case hi:
+                    for (size_t i = n.begin; i < n.end; i++) {
+                        if (STOP(inv) >= start_pos[i]) {
+                            count++;
+                        } else {
+                            break;
+                        }
                     }
-                }
-                return count_overlaps(inv, LEFT(tree), count);
-            default:
-                count += T_SIZE(tree);
-                return count_overlaps(inv, RIGHT(tree),
-                                      count_overlaps(inv, LEFT(tree), count));
+                    node = n.children[0];
+                    break;
+                default:
+                    count += n.end - n.begin;
+                    count = count_overlaps(inv, n.children[0], count);
+                    node = n.children[1];
+            }
         }
+        return count;
     }
 
     /** Count the number of query-side intervals that overlap a point
      *
      * @param point on the IntervalTree
-     * @param tree an IntervalTree
+     * @param node index of a node in the tree
      */
-    long count_overlaps(long pnt, IntervalTree<T>* tree, long count)
+    long count_point_overlaps(long pnt, long node, long count)
     {
-        if (pnt >= tree->center) {
-            for (long long i = T_SIZE(tree) - 1; i >= 0 ; i--) {
-                if (pnt <= T_STOP_STOP(tree, i)) {
-                    count++;
-                } else {
-                    break;
+        while (node != NIL) {
+            const Node& n = nodes[node];
+            if (pnt >= n.center) {
+                for (size_t i = n.end; i > n.begin; i--) {
+                    if (pnt <= stop_pos[i - 1]) {
+                        count++;
+                    } else {
+                        break;
+                    }
                 }
-            }
-            if (RIGHT(tree) != nullptr)
-                return count_overlaps(pnt, RIGHT(tree), count);
-        } else {
-            for (size_t i = 0; i < T_SIZE(tree); i++) {
-                if (pnt >= T_START_START(tree, i)) {
-                    count++;
-                } else {
-                    break;
+                node = n.children[1];
+            } else {
+                for (size_t i = n.begin; i < n.end; i++) {
+                    if (pnt >= start_pos[i]) {
+                        count++;
+                    } else {
+                        break;
+                    }
                 }
+                node = n.children[0];
             }
-            if (LEFT(tree) != nullptr)
-                return count_overlaps(pnt, LEFT(tree), count);
         }
         return count;
     }
@@ -130,92 +258,54 @@ private:
      * and retrieve whatever else they need.
      *
      * @param query the query search interval
-     * @param tree an IntervalTree
+     * @param node index of a node in the tree
      */
     template <class U>
-    IntervalResult<T>* get_overlaps(U* inv, IntervalTree<T>* tree, IntervalResult<T>* results)
+    void get_overlaps(U* inv, long node, IntervalResult<T>* results)
     {
-        if (tree == nullptr)
-            return results;
-        switch (inv->position_relative_to(tree->center)) {
-            case lo: // center lower than interval start
-                for (long long i = T_SIZE(tree) - 1; i >= 0 ; i--) {
-                    if (START(inv) <= T_STOP_STOP(tree, i)) {
-                        results->iv.push_back(T_STOP(tree, i));
-                    } else {
-                        break;
+        while (node != NIL) {
+            const Node& n = nodes[node];
+            switch (inv->position_relative_to(n.center)) {
+                case lo: // center lower than interval start
+                    for (size_t i = n.end; i > n.begin; i--) {
+                        if (START(inv) <= stop_pos[i - 1]) {
+                            results->iv.push_back(by_stop[i - 1]);
+                        } else {
+                            break;
+                        }
                     }
-                }
-                // Reach a leaf and still have no overlaps
-                if (RIGHT(tree) == nullptr && results->iv.size() == 0) {
-                    results->iv.push_back(LAST_STOP(tree));
-                    // get nearest interval on the other side
-                    set_nearest_opposing_interval(tree, results, hi);
-                }
-                return get_overlaps(inv, RIGHT(tree), results);
-            case hi:
-                for (size_t i = 0; i < T_SIZE(tree); i++) {
-                    if (STOP(inv) >= T_START_START(tree, i)) {
-                        results->iv.push_back(tree->by_start[i]);
-                    } else {
-                        break;
+                    // Reach a leaf and still have no overlaps
+                    if (n.children[1] == NIL && results->iv.size() == 0) {
+                        results->iv.push_back(by_stop[n.end - 1]);
+                        // get nearest interval on the other side
+                        set_nearest_opposing_interval(node, results, hi);
                     }
-                }
-                // Reach a leaf and still have no overlaps
-                if (LEFT(tree) == nullptr && results->iv.size() == 0) {
-                    results->iv.push_back(FIRST_START(tree));
-                    // get nearest interval on the other side
-                    set_nearest_opposing_interval(tree, results, lo);
-                }
-                return get_overlaps(inv, LEFT(tree), results);
-            default: // in
-                results->iv.insert(
-                    results->iv.end(),
-                    tree->by_start.begin(),
-                    tree->by_start.end()
-                );
-                // join_IV(results->iv, tree->by_start);
-                return get_overlaps(inv, RIGHT(tree),
-                                    get_overlaps(inv, LEFT(tree), results));
-        };
-    }
-
-    /** Count the number of query-side intervals that overlap a point
-     *
-     * If the pnt if greater than the length of the sequence, then 0 is returned.
-     *
-     * @param pnt a point position on the IntervalTree
-     * @param tree an IntervalTree
-     */
-    void get_point_overlaps(long pnt, IntervalTree<T>* tree, IntervalResult<T>* results)
-    {
-        if (pnt >= tree->center) {
-            for (long long i = T_SIZE(tree) - 1; i >= 0 ; i--) {
-                if (pnt <= T_STOP_STOP(tree, i)) {
-                    results->iv.push_back(T_STOP(tree, i));
-                } else {
+                    node = n.children[1];
                     break;
-                }
-            }
-            if (RIGHT(tree) != nullptr) {
-                get_overlaps(pnt, RIGHT(tree), results);
-            } else if (R_SIZE(results) != 0) {
-                results->iv.push_back(LAST_STOP(tree));
-                set_nearest_opposing_interval(tree, results, hi);
-            }
-        } else {
-            for (size_t i = 0; i < T_SIZE(tree); i++) {
-                if (pnt >= T_START_START(tree, i)) {
-                    results->iv.push_back(T_START(tree, i));
-                } else {
+                case hi:
+                    for (size_t i = n.begin; i < n.end; i++) {
+                        if (STOP(inv) >= start_pos[i]) {
+                            results->iv.push_back(by_start[i]);
+                        } else {
+                            break;
+                        }
+                    }
+                    // Reach a leaf and still have no overlaps
+                    if (n.children[0] == NIL && results->iv.size() == 0) {
+                        results->iv.push_back(by_start[n.begin]);
+                        // get nearest interval on the other side
+                        set_nearest_opposing_interval(node, results, lo);
+                    }
+                    node = n.children[0];
                     break;
-                }
-            }
-            if (LEFT(tree) != nullptr) {
-                get_overlaps(pnt, LEFT(tree), results);
-            } else if (R_SIZE(results) != 0) {
-                results->iv.push_back(FIRST_START(tree));
-                set_nearest_opposing_interval(tree, results, lo);
+                default: // in
+                    results->iv.insert(
+                        results->iv.end(),
+                        by_start.begin() + n.begin,
+                        by_start.begin() + n.end
+                    );
+                    get_overlaps(inv, n.children[0], results);
+                    node = n.children[1];
             }
         }
     }
@@ -240,22 +330,22 @@ private:
      * thus it will contain the nearest intervals.
      *
      */
-    void set_nearest_opposing_interval(IntervalTree<T>* node, IntervalResult<T>* results, Pos pos)
+    void set_nearest_opposing_interval(long node, IntervalResult<T>* results, Pos pos)
     {
 
-        Orientation l_orientation = node->orientation;
+        Orientation l_orientation = nodes[node].orientation;
 
         if ((pos == hi && l_orientation == O_LEFT) ||
                 (pos == lo && l_orientation == O_RIGHT)) {
-            node = node->parent;
+            node = nodes[node].parent;
         } else {
-            while (node->orientation != O_ROOT && node->orientation == l_orientation) {
-                node = node->parent;
+            while (nodes[node].orientation != O_ROOT && nodes[node].orientation == l_orientation) {
+                node = nodes[node].parent;
             }
-            node = node->parent;
+            node = nodes[node].parent;
         }
 
-        if (node == nullptr) {
+        if (node == NIL) {
             if (pos == lo) {
                 results->leftmost = true;
             } else {
@@ -264,111 +354,54 @@ private:
         } else {
             results->inbetween = true;
             if (l_orientation == O_RIGHT) {
-                results->iv.push_back(node->by_start.front());
+                results->iv.push_back(by_start[nodes[node].begin]);
             } else if (l_orientation == O_LEFT) {
-                results->iv.push_back(node->by_stop[node->by_stop.size() - 1]);
+                results->iv.push_back(by_stop[nodes[node].end - 1]);
             }
         }
     }
 
-protected:
-    // the center position for this node
-    long center = 0;
-    // all intervals that overlap the center, sorted by start position
-    std::vector<T*> by_start;
-    // all intervals that overlap the center, sorted by stop position
-    std::vector<T*> by_stop;
-    // Child nodes
-    IntervalTree* children[2] = {nullptr, nullptr};
-    // Parent
-    IntervalTree* parent = nullptr;
-    // position relative to parent
-    Orientation orientation = O_ROOT;
-
 public:
-    IntervalTree(
-        std::vector<T*> intervals,
-        IntervalTree<T>* new_parent = nullptr,
-        Orientation new_orientation = O_ROOT
-    ) :
-        parent(new_parent), orientation(new_orientation)
+    IntervalTree(const std::vector<T*>& intervals)
     {
-
-        center = get_center(intervals);
-
-        std::vector<T*> left;
-        std::vector<T*> right;
-
-        /** iterate over intervals classifying and counting each */
-        for(size_t i = 0; i < intervals.size(); i++) {
-            T* v = intervals[i];
-            switch(v->position_relative_to(center)) {
-                case lo:
-                    right.push_back(v);
-                    break;
-                case hi:
-                    left.push_back(v);
-                    break;
-                case in:
-                    by_stop.push_back(v);
-                    by_start.push_back(v);
-                    break;
-                default:
-                    break;
-            }
+        size_t n = intervals.size();
+        if (n == 0) {
+            return;
         }
 
-        if(!by_start.empty())
-            std::sort(by_start.begin(), by_start.end(), cmp_start);
-
-        if(!by_stop.empty())
-            std::sort(by_stop.begin(), by_stop.end(), cmp_stop);
-
-        if (left.empty()) {
-            children[0] = nullptr;
-        } else {
-            children[0] = new IntervalTree<T>(left, this, O_LEFT);
+        std::vector<size_t> idx(n);
+        for (size_t i = 0; i < n; i++) {
+            idx[i] = i;
         }
+        std::vector<size_t> scratch(n);
+        std::vector<long> node_of(n);
 
-        if (right.empty()) {
-            children[1] = nullptr;
-        } else {
-            children[1] = new IntervalTree<T>(right, this, O_RIGHT);
-        }
+        build(intervals, idx, scratch, node_of, 0, n, NIL, O_ROOT);
+        build_arrays(intervals, node_of);
     }
 
-    ~IntervalTree()
-    {
-        delete children[0];
-        delete children[1];
-    }
+    ~IntervalTree() { }
 
     template <class U>
     long count_overlaps(U* inv)
     {
-        return count_overlaps(inv, this, 0);
+        return nodes.empty() ? 0 : count_overlaps(inv, 0, 0);
     }
 
-    long count_overlaps(long pnt)
+    long count_point_overlaps(long pnt)
     {
-        return count_overlaps(pnt, this, 0);
+        return nodes.empty() ? 0 : count_point_overlaps(pnt, 0, 0);
     }
 
+    /** Find the overlaps of an interval, replacing the contents of res */
     template <class U>
-    IntervalResult<T>* get_overlaps(U* inv)
+    void get_overlaps(U* inv, IntervalResult<T>& res)
     {
-        auto res = new IntervalResult<T>;
-        res->tree = this;
-        get_overlaps(inv, this, res);
-        return res;
-    }
-
-    IntervalResult<T>* get_point_overlaps(long pnt)
-    {
-        IntervalResult<T>* res = new IntervalResult<T>;
-        res->tree = this;
-        get_overlaps(pnt, this, res);
-        return res;
+        res.clear();
+        res.tree = this;
+        if (!nodes.empty()) {
+            get_overlaps(inv, 0, &res);
+        }
     }
 
 };
@@ -0,0 +1,169 @@
+#include "line_reader.h"
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+
+static inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+LineReader::LineReader(const std::string& filename)
+    : m_file(new MappedFile(filename))
+{
+    m_next = m_file->data();
+    m_end  = m_file->data() + m_file->size();
+}
+
+LineReader::LineReader(const char* begin, const char* end)
+    : m_next(begin), m_end(end)
+{ }
+
+std::vector< std::pair<const char*, const char*> >
+LineReader::chunks(const char* data, size_t size, size_t n)
+{
+    std::vector< std::pair<const char*, const char*> > out;
+    const char* end = data + size;
+    const char* a = data;
+    for (size_t i = 1; i <= n && a < end; i++) {
+        const char* b = (i == n) ? end : data + (size * i) / n;
+        if (b < a) {
+            b = a;
+        }
+        // extend the chunk to the end of the line it stops in
+        if (b < end) {
+            const char* nl = static_cast<const char*>(std::memchr(b, '\n', end - b));
+            b = nl == nullptr ? end : nl + 1;
+        }
+        out.push_back(std::make_pair(a, b));
+        a = b;
+    }
+    return out;
+}
+
+bool LineReader::readable(const std::string& filename)
+{
+    std::ifstream fh(filename);
+    return fh.good();
+}
+
+bool LineReader::next_line()
+{
+    if (m_next == nullptr || m_next >= m_end) {
+        return false;
+    }
+    m_line = m_next;
+    const char* nl = static_cast<const char*>(
+        std::memchr(m_line, '\n', m_end - m_line)
+    );
+    m_line_end = nl == nullptr ? m_end : nl;
+    m_next     = nl == nullptr ? m_end : nl + 1;
+    m_cursor   = m_line;
+    return true;
+}
+
+bool LineReader::is_blank() const
+{
+    for (const char* p = m_line; p < m_line_end; p++) {
+        if (!is_space(*p)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LineReader::read(Field& x)
+{
+    const char* p = m_cursor;
+    while (p < m_line_end && is_space(*p)) {
+        p++;
+    }
+    if (p == m_line_end) {
+        m_cursor = p;
+        return false;
+    }
+    const char* q = p;
+    while (q < m_line_end && !is_space(*q)) {
+        q++;
+    }
+    x.ptr    = p;
+    x.len    = q - p;
+    m_cursor = q;
+    return true;
+}
+
+bool LineReader::read(std::string& x)
+{
+    Field f;
+    if (!read(f)) {
+        return false;
+    }
+    // reuses the capacity of x, so there is usually no allocation
+    x.assign(f.ptr, f.len);
+    return true;
+}
+
+bool LineReader::read(long& x)
+{
+    Field f;
+    if (!read(f)) {
+        return false;
+    }
+    const char* p   = f.ptr;
+    const char* end = f.ptr + f.len;
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        p++;
+    }
+    if (p == end) {
+        return false;
+    }
+    long value = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        long digit = *p - '0';
+        // out of range, as std::istream would fail on it
+        if (value > (LONG_MAX - digit) / 10) {
+            return false;
+        }
+        value = value * 10 + digit;
+    }
+    x = negative ? -value : value;
+    return true;
+}
+
+bool LineReader::read(double& x)
+{
+    Field f;
+    if (!read(f)) {
+        return false;
+    }
+    // strtod needs a terminated string, and the mapping is not terminated
+    char buf[64];
+    if (f.len >= sizeof(buf)) {
+        return false;
+    }
+    std::memcpy(buf, f.ptr, f.len);
+    buf[f.len] = '\0';
+    char* end;
+    double value = std::strtod(buf, &end);
+    if (end != buf + f.len) {
+        return false;
+    }
+    x = value;
+    return true;
+}
+
+bool LineReader::read(char& x)
+{
+    Field f;
+    if (!read(f)) {
+        return false;
+    }
+    x = f.ptr[0];
+    return true;
+}
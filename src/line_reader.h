@@ -0,0 +1,118 @@
+#ifndef __LINE_READER_H__
+#define __LINE_READER_H__
+
+#include "mapped_file.h"
+
+#include <string>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <utility>
+
+/** A whitespace-delimited field that points into the mapped file */
+class Field
+{
+public:
+    const char* ptr = nullptr;
+    size_t      len = 0;
+
+    Field() { }
+    Field(const char* t_ptr, size_t t_len) : ptr(t_ptr), len(t_len) { }
+
+    bool empty() const { return len == 0; }
+
+    std::string str() const { return std::string(ptr, len); }
+
+    bool operator==(const std::string& s) const
+    {
+        return s.size() == len && std::memcmp(s.data(), ptr, len) == 0;
+    }
+
+    bool operator!=(const std::string& s) const { return !(*this == s); }
+
+    bool operator==(const Field& o) const
+    {
+        return o.len == len && std::memcmp(o.ptr, ptr, len) == 0;
+    }
+
+    bool operator!=(const Field& o) const { return !(*this == o); }
+};
+
+/** Tokenize a text file in place, one line at a time
+ *
+ * The file is memory mapped and fields are parsed directly from the mapping,
+ * no line or field is copied unless a string is asked for. Fields are split on
+ * whitespace, exactly as `std::istream >>` would split them, so this is a
+ * drop-in replacement for the `std::getline` / `std::istringstream` idiom.
+ *
+ * Typical use:
+ *
+ *     LineReader fh(filename);
+ *     while (fh.next_line()) {
+ *         if (fh.is_comment())
+ *             continue;
+ *         if (fh.read(a) && fh.read(b)) { ... }
+ *     }
+ */
+class LineReader
+{
+private:
+    std::unique_ptr<MappedFile> m_file;
+    const char* m_next     = nullptr; // start of the next line
+    const char* m_end      = nullptr; // end of the file
+    const char* m_line     = nullptr; // start of the current line
+    const char* m_line_end = nullptr; // end of the current line (excluding '\n')
+    const char* m_cursor   = nullptr; // parse position in the current line
+
+public:
+    LineReader(const std::string& filename);
+
+    /** Tokenize memory that is owned elsewhere, e.g. one chunk of a MappedFile */
+    LineReader(const char* begin, const char* end);
+
+    /** Check whether a file can be opened, without opening it for parsing */
+    static bool readable(const std::string& filename);
+
+    /** Split [data, data + size) into at most n chunks of whole lines
+     *
+     * Chunks are roughly equal in size and each (except possibly the last)
+     * ends just after a newline.
+     */
+    static std::vector< std::pair<const char*, const char*> >
+    chunks(const char* data, size_t size, size_t n);
+
+    /** Move to the next line, return false at the end of the file */
+    bool next_line();
+
+    /** true once every line has been read */
+    bool eof() const
+    {
+        return m_next == nullptr || m_next >= m_end;
+    }
+
+    /** true for lines starting with '#' */
+    bool is_comment() const
+    {
+        return m_line < m_line_end && *m_line == '#';
+    }
+
+    /** true for lines with nothing but whitespace */
+    bool is_blank() const;
+
+    /** Copy of the current line (without the newline) */
+    std::string line() const
+    {
+        return std::string(m_line, m_line_end - m_line);
+    }
+
+    // Read the next field of the current line. Each returns false, and leaves
+    // the output unchanged, if there are no more fields or the field cannot
+    // be parsed as the requested type.
+    bool read(Field& x);
+    bool read(std::string& x);
+    bool read(long& x);
+    bool read(double& x);
+    bool read(char& x);
+};
+
+#endif
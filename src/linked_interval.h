@@ -7,6 +7,7 @@
 
 #include <Rcpp.h>
 #include <array>
+#include <cstdint>
 
 
 template<class T> class LinkedInterval
@@ -37,6 +38,9 @@ public:
     // unique id for element
     size_t id = 0;
 
+    // row in the frozen BlockTable, set once the synteny map is complete
+    uint32_t row = UINT32_MAX;
+
     LinkedInterval() { }
 
     LinkedInterval(
@@ -54,6 +58,9 @@ public:
 
     ~LinkedInterval() { }
 
+    // strand of the homologous element relative to this one
+    char over_strand() const { return strand == over->strand ? '+' : '-'; }
+
     T* prev()        { return cor[0]; }
     T* next()        { return cor[1]; }
     T* prev_bystop() { return cor[2]; }
@@ -1,5 +1,12 @@
 #include "many_blocks.h"
 
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+
 ManyBlocks::ManyBlocks() { }
 
 ManyBlocks::~ManyBlocks(){ }
@@ -74,7 +81,7 @@ void ManyBlocks::link_corners(){
             cor[i] = b;
         }
     } catch (const std::out_of_range& e) {
-        Rcpp::stop("Index error in ManyBlocks::link_corners()\n");
+        throw std::runtime_error("Index error in ManyBlocks::link_corners()\n");
     }
 }
 
@@ -116,6 +123,11 @@ void ManyBlocks::set_overlap_group(long &grpid)
      * e->adj := (d, nullptr)
      */
 void ManyBlocks::link_adjacent_blocks_directed(Direction d)
+{
+    link_adjacent_blocks_directed(d, 0, inv.size());
+}
+
+void ManyBlocks::link_adjacent_blocks_directed(Direction d, size_t first, size_t last)
 {
     // In diagrams:
     // <--- indicates a hi block
@@ -123,7 +135,7 @@ void ManyBlocks::link_adjacent_blocks_directed(Direction d)
     // All diagrams and comments relative to the d==HI direction
 
     if (cor[0] == nullptr || cor[1] == nullptr || cor[2] == nullptr || cor[3] == nullptr) {
-        Rcpp::stop("Contig head must be set before link_adjacent_blocks is called\n");
+        throw std::runtime_error("Contig head must be set before link_adjacent_blocks is called\n");
     }
 
     // Transformed indices for Block->cor and Contig->cor
@@ -132,12 +144,25 @@ void ManyBlocks::link_adjacent_blocks_directed(Direction d)
     int idx_c = ( d * 2) + !d; // - 2 previous/first element by stop
     int idx_d = ( d * 2) +  d; // - 3 next/last element by stop
 
-    Block *lo, *hi;
-
-    lo = cor[idx_c]; // first element by stop
-    hi = cor[idx_a]; // first element by start
+    Block *lo, *hi, *end;
+
+    // The blocks just outside the run, which no block of the run overlaps.
+    // For the whole contig, lo is the first element by stop and hi the first
+    // element by start.
+    Block* before = first == 0          ? nullptr : group_back(first - 1);
+    Block* after  = last  == inv.size() ? nullptr : inv[last];
+
+    if (d == HI) {
+        hi  = before == nullptr ? cor[idx_a] : inv[first];
+        end = after;
+        lo  = before == nullptr ? cor[idx_c] : before;
+    } else {
+        hi  = after  == nullptr ? cor[idx_a] : group_back(last - 1);
+        end = before;
+        lo  = after  == nullptr ? cor[idx_c] : after;
+    }
 
-    while (hi != nullptr) {
+    while (hi != end) {
 
         //       --->
         // <---
@@ -169,27 +194,165 @@ void ManyBlocks::link_adjacent_blocks_directed(Direction d)
     }
 }
 
+void ManyBlocks::link_adjacent_blocks(size_t first, size_t last)
+{
+    link_adjacent_blocks_directed(HI, first, last);
+    link_adjacent_blocks_directed(LO, first, last);
+}
+
 void ManyBlocks::link_adjacent_blocks()
 {
-    link_adjacent_blocks_directed(HI);
-    link_adjacent_blocks_directed(LO);
+    link_adjacent_blocks(0, inv.size());
+}
+
+Block* ManyBlocks::group_back(size_t i)
+{
+    // groups are runs by stop too, so only the last block of a group by stop
+    // links to a block of another group or to nothing
+    long grpid = inv[i]->grpid;
+    for (; i > 0 && inv[i - 1]->grpid == grpid; i--) { }
+    for (; i < inv.size() && inv[i]->grpid == grpid; i++) {
+        Block* blk = inv[i];
+        if (blk->over != nullptr &&
+            (blk->cor[3] == nullptr || blk->cor[3]->grpid != grpid)) {
+            return blk;
+        }
+    }
+    throw std::runtime_error("Group without a last block in ManyBlocks::group_back()\n");
+}
+
+std::vector<size_t> ManyBlocks::split_groups(size_t size)
+{
+    std::vector<size_t> bounds(1, 0);
+    for (size_t i = 1; i < inv.size(); i++) {
+        if (i - bounds.back() >= size && inv[i]->grpid != inv[i - 1]->grpid) {
+            bounds.push_back(i);
+        }
+    }
+    bounds.push_back(inv.size());
+    return bounds;
+}
+
+void ManyBlocks::cut_seams(const std::vector<size_t>& bounds)
+{
+    for (size_t s = 1; s + 1 < bounds.size(); s++) {
+        size_t b = bounds[s];
+        inv[b - 1]->cor[1] = nullptr;
+        inv[b]->cor[0] = nullptr;
+        Block* back = group_back(b - 1);
+        back->cor[3]->cor[2] = nullptr;
+        back->cor[3] = nullptr;
+    }
+}
+
+void ManyBlocks::stitch_seams(const std::vector<size_t>& bounds)
+{
+    for (size_t s = 1; s + 1 < bounds.size(); s++) {
+        // every group keeps at least one block, find the nearest ones on
+        // either side of the seam
+        size_t lo = bounds[s] - 1;
+        size_t hi = bounds[s];
+        for (; inv[lo]->over == nullptr; lo--) { }
+        for (; inv[hi]->over == nullptr; hi++) { }
+        // then the ends of both runs by start (i = 0) and by stop (i = 1)
+        for (size_t i = 0; i < 2; i++) {
+            Block* a = inv[lo];
+            Block* b = inv[hi];
+            for (; a->cor[2 * i + 1] != nullptr; a = a->cor[2 * i + 1]) { }
+            for (; b->cor[2 * i] != nullptr; b = b->cor[2 * i]) { }
+            a->cor[2 * i + 1] = b;
+            b->cor[2 * i] = a;
+        }
+    }
 }
 
-void ManyBlocks::merge_overlaps()
+void ManyBlocks::merge_overlaps(std::vector<Relink>* relinks)
 {
-    Block *lo, *hi;
+    merge_overlaps(0, inv.size(), relinks);
+}
 
-    // iterate through all blocks
-    for (lo = front(); lo != nullptr; lo = lo->next()) {
-        // look ahead to find all doubly-overlapping blocks
-        for (hi = lo->next(); hi != nullptr; hi = hi->next()) {
-            if (!hi->overlap(lo)) {
+void ManyBlocks::merge_overlaps(size_t first, size_t last, std::vector<Relink>* relinks)
+{
+    // inv is in the order of the blocks by start, see link_block_corners.
+    // Blocks after the current one that start before it stops are swept into
+    // the active set, ordered by target contig and start. Blocks found there
+    // that overlap the current block on the target too are moved to a queue
+    // by their position in inv and merged, lowest position first, into the
+    // current block. Merging grows the block, so the sweep goes on until no
+    // doubly-overlapping block is left.
+    typedef std::tuple<const Feature*, long, size_t> Key;
+    std::set<Key> active;
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> queue;
+    // target interval lengths of the active blocks, the longest bounds how
+    // far before the current block an overlapping one may start
+    std::multiset<long> lengths;
+    size_t next = first;
+    std::vector<bool> skipped(last - first, false);
+
+    auto key = [&](size_t i) {
+        Block* blk = inv[i];
+        return Key(blk->over->parent, blk->over->pos[0], i);
+    };
+    auto length = [&](size_t i) {
+        return inv[i]->over->pos[1] - inv[i]->over->pos[0];
+    };
+    auto deactivate = [&](size_t i) {
+        if (active.erase(key(i)) > 0) {
+            lengths.erase(lengths.find(length(i)));
+        }
+    };
+
+    for (size_t i = first; i < last; i++) {
+        Block* lo = inv[i];
+        // skip blocks already merged into an earlier block
+        if (lo->over == nullptr || skipped[i - first]) {
+            continue;
+        }
+        deactivate(i);
+        next = std::max(next, i + 1);
+
+        while (true) {
+            for (; next < last && inv[next]->pos[0] <= lo->pos[1]; next++) {
+                if (inv[next]->over != nullptr) {
+                    active.insert(key(next));
+                    lengths.insert(length(next));
+                }
+            }
+
+            const Feature* parent = lo->over->parent;
+            long max_length = lengths.empty() ? 0 : *lengths.rbegin();
+            auto it  = active.lower_bound(Key(parent, lo->over->pos[0] - max_length, 0));
+            auto end = active.upper_bound(Key(parent, lo->over->pos[1], last));
+            while (it != end) {
+                Block* hi = inv[std::get<2>(*it)];
+                if (hi->over->pos[1] >= lo->over->pos[0] && hi->overlap(lo)) {
+                    queue.push(std::get<2>(*it));
+                    lengths.erase(lengths.find(length(std::get<2>(*it))));
+                    it = active.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            if (queue.empty()) {
                 break;
             }
-            if (hi->over->overlap(lo->over) && hi->over->parent == lo->over->parent) {
-                Block::merge_block_a_into_b(hi, lo);
-                hi = lo;
+            size_t h = queue.top();
+            queue.pop();
+
+            // A merged block with the same start takes lo to its place in
+            // the order by start, so the blocks in between are passed over,
+            // neither merged into lo nor visited afterwards.
+            if (inv[h]->pos[0] == lo->pos[0]) {
+                for (; i < h; i++) {
+                    if (inv[i]->over != nullptr && inv[i] != lo) {
+                        deactivate(i);
+                        skipped[i - first] = true;
+                    }
+                }
             }
+
+            Block::merge_block_a_into_b(inv[h], lo, relinks);
         }
     }
 }
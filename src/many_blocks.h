@@ -13,6 +13,10 @@
 
 class ManyBlocks : public IntervalSet<Block>
 {
+private:
+    /** The block of the overlap group of inv[i] that stops last */
+    Block* group_back(size_t i);
+
 public:
     std::array<Block*, 4> cor = {{ nullptr }};
 
@@ -35,9 +39,37 @@ public:
 
     void link_block_corners();
     void set_overlap_group(long& offset);
+
+    /** Split inv into runs of whole overlap groups
+     *
+     * Each run but the last holds at least `size` blocks. Returns the offsets
+     * of the runs in inv, from 0 to inv.size(). Neither merging nor adjacency
+     * crosses a group, so the runs can be processed independently.
+     */
+    std::vector<size_t> split_groups(size_t size);
+
+    /** Unlink the corners across the seams between the runs of split_groups */
+    void cut_seams(const std::vector<size_t>& bounds);
+
+    /** Relink the corners across the seams after merge_overlaps */
+    void stitch_seams(const std::vector<size_t>& bounds);
+
+    /** Link the adjacent blocks of the run of whole groups inv[first, last)
+     *
+     * Blocks outside the run are read, but not changed.
+     */
+    void link_adjacent_blocks_directed(Direction d, size_t first, size_t last);
     void link_adjacent_blocks_directed(Direction d);
+    void link_adjacent_blocks(size_t first, size_t last);
     void link_adjacent_blocks();
-    void merge_overlaps();
+
+    /** Merge doubly-overlapping blocks, see Block::merge_block_a_into_b
+     *
+     * Only the blocks of the run of whole groups inv[first, last) are merged,
+     * its seams must be cut first (see cut_seams).
+     */
+    void merge_overlaps(size_t first, size_t last, std::vector<Relink>* relinks = nullptr);
+    void merge_overlaps(std::vector<Relink>* relinks = nullptr);
     void refresh();
 
 };
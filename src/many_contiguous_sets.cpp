@@ -1,45 +1,105 @@
 #include "many_contiguous_sets.h"
 
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+
 ManyContiguousSets::ManyContiguousSets() { }
 
-ManyContiguousSets::~ManyContiguousSets() {
-    for(auto &c : inv){
-        delete c;
-    }
-}
+ManyContiguousSets::~ManyContiguousSets() { }
 
 void ManyContiguousSets::link_contiguous_blocks(
     Block* b,
     long k,
-    size_t& setid
+    size_t& setid,
+    const std::function<ContiguousSet*(Block*, size_t)>& make_set,
+    const ConflictIndex& conflicts
 )
 {
-    // get a reverse iterator
-    auto iter = inv.rbegin();
+    // A block joins the newest set that accepts it, but the search stops at
+    // the newest set that is strictly forbidden, where a new set is started.
+    // Blocks come in overlap group order, so a forbidden set stays forbidden
+    // and every set older than it is out of reach for good. Of the sets in
+    // reach, only those ending in a target overlap group at most k+1 groups
+    // behind the block (in the direction of its strand) can accept it.
+    //
+    // Sets are identified by their index in inv. Open sets are those not yet
+    // known to be forbidden, indexed by the overlap groups of their last block.
+    std::set<std::pair<long, size_t>>    by_qgrp;
+    std::map<long, std::vector<size_t>>  by_tgrp;
+    // sets before this one can no longer be reached
+    size_t barrier = 0;
+    std::vector<size_t> candidates;
+
+    auto open = [&](size_t i) {
+        Block* last = inv[i]->ends[1];
+        by_qgrp.insert(std::make_pair(last->grpid, i));
+        by_tgrp[last->over->grpid].push_back(i);
+    };
+
+    // last is the block the set ended with when it was opened
+    auto close = [&](size_t i, Block* last) {
+        by_qgrp.erase(std::make_pair(last->grpid, i));
+        auto it = by_tgrp.find(last->over->grpid);
+        it->second.erase(std::find(it->second.begin(), it->second.end(), i));
+        if (it->second.empty()) {
+            by_tgrp.erase(it);
+        }
+    };
+
+    for (size_t i = 0; i < inv.size(); i++) {
+        open(i);
+    }
+
     for (; b != nullptr; b = b->next()) {
-        for (iter = inv.rbegin(); /* */ ; iter++) {
-            // do after iterating through every element 
-            if (iter == inv.rend()) {
-                // if block fits in no set, create a new one
-                inv.push_back(new ContiguousSet(b, setid++));
+        // retire the sets that became forbidden, oldest last block first
+        while (!by_qgrp.empty()) {
+            size_t i = by_qgrp.begin()->second;
+            if (!ContiguousSet::strictly_forbidden(inv[i]->ends[1], b, k)) {
                 break;
             }
-            // if block successfully joins a set
-            else if ((*iter)->add_block(b, k)) {
-                break;
+            barrier = std::max(barrier, i + 1);
+            close(i, inv[i]->ends[1]);
+        }
+
+        candidates.clear();
+        if (k + 1 > 0) {
+            long btg = b->over->grpid;
+            auto first = by_tgrp.lower_bound(b->over->strand == '+' ? btg - (k + 1) : btg + 1);
+            auto last  = by_tgrp.upper_bound(b->over->strand == '+' ? btg - 1 : btg + (k + 1));
+            for (; first != last; ++first) {
+                for (auto i : first->second) {
+                    if (i >= barrier) {
+                        candidates.push_back(i);
+                    }
+                }
             }
-            // if set terminates
-            else if (ContiguousSet::strictly_forbidden((*iter)->ends[1], b, k)) {
-                inv.push_back(new ContiguousSet(b, setid++));
+        }
+        std::sort(candidates.begin(), candidates.end(), std::greater<size_t>());
+
+        bool joined = false;
+        for (auto i : candidates) {
+            Block* last = inv[i]->ends[1];
+            if (inv[i]->add_block(b, k, conflicts)) {
+                close(i, last);
+                open(i);
+                joined = true;
                 break;
             }
         }
+
+        // if block fits in no set, create a new one
+        if (!joined) {
+            inv.push_back(make_set(b, setid++));
+            open(inv.size() - 1);
+        }
     }
 }
 
-void ManyContiguousSets::add_from_homolog(ContiguousSet* a)
+void ManyContiguousSets::add_from_homolog(ContiguousSet* a, Arena<ContiguousSet>& pool)
 {
-    ContiguousSet* b = new ContiguousSet(a);
+    ContiguousSet* b = pool.make(a);
 
     b->over = a;
     a->over = b;
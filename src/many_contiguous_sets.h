@@ -4,25 +4,40 @@
 #include "global.h"
 #include "contiguous_set.h"
 #include "interval_set.h"
+#include "arena.h"
 
-/** A containter for ContiguousSets */
+#include <functional>
+
+/** A containter for ContiguousSets
+ *
+ * The sets themselves are owned by the arena of their Genome.
+ */
 class ManyContiguousSets : public IntervalSet<ContiguousSet>
 {
 public:
     ManyContiguousSets();
     ~ManyContiguousSets();
+
+    /** Chain the blocks of a contig, starting at front, into contiguous sets
+     *
+     * @param setid    - id of the next new set, incremented for each set
+     * @param make_set - allocates a new set from its first block and id
+     */
     void link_contiguous_blocks(
         Block*  front,
         long    k,
-        size_t& setid
+        size_t& setid,
+        const std::function<ContiguousSet*(Block*, size_t)>& make_set,
+        const ConflictIndex& conflicts
     );
 
     /** Build a contiguous set from the homologous set
      *
      * @param first - The first block in the homologous set
+     * @param pool  - where to allocate the new set
      *
      */
-    void add_from_homolog(ContiguousSet* first);
+    void add_from_homolog(ContiguousSet* first, Arena<ContiguousSet>& pool);
 };
 
 #endif
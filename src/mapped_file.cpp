@@ -0,0 +1,64 @@
+#include "mapped_file.h"
+
+#include <fstream>
+#include <iterator>
+#include <Rcpp.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename)
+{
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Rcpp::stop("Failed to open file '" + filename + "'\n");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        Rcpp::stop("Failed to stat file '" + filename + "'\n");
+    }
+    m_size = static_cast<size_t>(st.st_size);
+
+    // mmap fails on empty files, but an empty file is a perfectly good input
+    if (m_size > 0) {
+        void* addr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            Rcpp::stop("Failed to map file '" + filename + "'\n");
+        }
+        // the file is read front to back
+        madvise(addr, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char*>(addr);
+        m_mapped = true;
+    }
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+#else
+    std::ifstream fh(filename, std::ios::binary);
+    if (!fh) {
+        Rcpp::stop("Failed to open file '" + filename + "'\n");
+    }
+    m_buffer.assign(
+        std::istreambuf_iterator<char>(fh),
+        std::istreambuf_iterator<char>()
+    );
+    m_size = m_buffer.size();
+    m_data = m_buffer.empty() ? nullptr : m_buffer.data();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (m_mapped) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+}
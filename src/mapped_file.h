@@ -0,0 +1,35 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <string>
+#include <vector>
+
+/** A read-only view of a whole file
+ *
+ * The file is memory mapped where the platform supports it, so the pages are
+ * shared between all processes that map the same file. Elsewhere the file is
+ * simply read into a private buffer.
+ */
+class MappedFile
+{
+private:
+    const char* m_data = nullptr;
+    size_t      m_size = 0;
+    bool        m_mapped = false;
+    std::vector<char> m_buffer;
+
+    // no copies, the destructor releases the mapping
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    /** Map the file, calls Rcpp::stop if the file cannot be opened */
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    const char* data()  const { return m_data; }
+    size_t      size()  const { return m_size; }
+    bool        empty() const { return m_size == 0; }
+};
+
+#endif
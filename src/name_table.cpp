@@ -0,0 +1,57 @@
+#include "name_table.h"
+
+const size_t NameTable::NONE;
+
+size_t NameTable::slot(const char* s, size_t len) const
+{
+    size_t mask = m_slots.size() - 1;
+    size_t i = hash(s, len) & mask;
+    while (m_slots[i] != NONE) {
+        const std::string& x = m_names[m_slots[i]];
+        if (x.size() == len && std::memcmp(x.data(), s, len) == 0) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void NameTable::rehash(size_t nslots)
+{
+    m_slots.assign(nslots, NONE);
+    for (size_t id = 0; id < m_names.size(); id++) {
+        m_slots[slot(m_names[id].data(), m_names[id].size())] = id;
+    }
+}
+
+size_t NameTable::intern(const char* s, size_t len)
+{
+    // keep the load factor at or below 1/2 (the slot count is a power of 2)
+    if (2 * (m_names.size() + 1) > m_slots.size()) {
+        rehash(m_slots.empty() ? 16 : 2 * m_slots.size());
+    }
+    size_t i = slot(s, len);
+    if (m_slots[i] == NONE) {
+        m_slots[i] = m_names.size();
+        m_names.push_back(std::string(s, len));
+    }
+    return m_slots[i];
+}
+
+size_t NameTable::find(const char* s, size_t len) const
+{
+    if (m_slots.empty()) {
+        return NONE;
+    }
+    return m_slots[slot(s, len)];
+}
+
+std::vector<std::string> NameTable::names(const std::vector<size_t>& ids) const
+{
+    std::vector<std::string> out;
+    out.reserve(ids.size());
+    for (auto id : ids) {
+        out.push_back(m_names[id]);
+    }
+    return out;
+}
@@ -0,0 +1,58 @@
+#ifndef __NAME_TABLE_H__
+#define __NAME_TABLE_H__
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+/** Interned strings with dense integer ids
+ *
+ * Contig names are stored once here and referred to everywhere else by their
+ * id, the index into the table. Lookups hash the raw characters, so no string
+ * is built just to find a name.
+ */
+class NameTable
+{
+private:
+    std::vector<std::string> m_names;
+    // open addressing hash table of ids into m_names, NONE for empty slots
+    std::vector<size_t> m_slots;
+
+    static size_t hash(const char* s, size_t len)
+    {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ (unsigned char) s[i]) * 1099511628211ULL;
+        }
+        return (size_t) h;
+    }
+
+    // index of the slot holding the name, or of the empty slot it would go in
+    size_t slot(const char* s, size_t len) const;
+
+    void rehash(size_t nslots);
+
+public:
+    static const size_t NONE = (size_t) -1;
+
+    /** Get the id of a name, adding it if needed */
+    size_t intern(const char* s, size_t len);
+
+    size_t intern(const std::string& s) { return intern(s.data(), s.size()); }
+
+    /** Get the id of a name, NONE if it has not been interned */
+    size_t find(const char* s, size_t len) const;
+
+    size_t find(const std::string& s) const { return find(s.data(), s.size()); }
+
+    const std::string& name(size_t id) const { return m_names[id]; }
+
+    /** Look up the names of many ids, e.g. the contig column of an output table */
+    std::vector<std::string> names(const std::vector<size_t>& ids) const;
+
+    size_t size() const { return m_names.size(); }
+};
+
+#endif
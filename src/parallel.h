@@ -0,0 +1,58 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+/** Call f(i) for every i in [0, n) on up to `threads` threads
+ *
+ * Each thread takes the next index from a shared counter whenever it is done
+ * with its last one, so when the largest items come first a few huge items and
+ * many tiny ones still keep every thread busy. The calling thread works too.
+ * The first exception thrown by f is rethrown on the calling thread once all
+ * threads have stopped. Unless threads is 1 (everything then runs in order on
+ * the calling thread) f must not call the R API.
+ */
+template <class F>
+void parallel_for(size_t n, size_t threads, F f)
+{
+    if (threads <= 1 || n <= 1) {
+        for (size_t i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+
+    size_t nworkers = std::min(threads, n);
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(nworkers);
+
+    auto work = [&](size_t t) {
+        try {
+            for (size_t i = next++; i < n; i = next++) {
+                f(i);
+            }
+        } catch (...) {
+            errors[t] = std::current_exception();
+            // hand out no more work
+            next = n;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < nworkers; t++) {
+        workers.push_back(std::thread(work, t));
+    }
+    work(0);
+    for (auto& w : workers) {
+        w.join();
+    }
+    for (auto& e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "query_cursor.h"
+
+static std::string check_gff(const std::string& gfffile)
+{
+    if(! LineReader::readable(gfffile)){
+        Rcpp::stop("Failed to open GFF file\n");
+    }
+    return gfffile;
+}
+
+QueryCursor::QueryCursor(
+    Synmap*     t_synmap,
+    std::string gfffile,
+    std::string t_command,
+    size_t      t_chunk_size,
+    size_t      t_gid
+)
+    :
+    synmap(t_synmap),
+    fh(check_gff(gfffile)),
+    chunk_size(t_chunk_size),
+    gid(t_gid)
+{
+    if (t_command == "search") {
+        command = SEARCH;
+    } else if (t_command == "map") {
+        command = MAP;
+    } else if (t_command == "count") {
+        command = COUNT;
+    } else {
+        Rcpp::stop("Unexpected command '" + t_command + "', expected search, map or count");
+    }
+    if (chunk_size == 0) {
+        Rcpp::stop("Chunk size must be positive");
+    }
+}
+
+std::vector<Feature> QueryCursor::read_chunk()
+{
+    std::vector<FeatureRow> rows;
+    std::vector<std::string> failingLines;
+
+    rows.reserve(chunk_size);
+    synmap->read_feature_rows(fh, chunk_size, rows, failingLines);
+    dieOnfailingLines(failingLines);
+
+    nfeatures += rows.size();
+
+    // the rows point into fh, resolve them before the next chunk is read
+    std::vector<Feature> feats = synmap->rows2features(rows, gid, missingContigs, presentContigs);
+
+    if (done() && !warned) {
+        missingContigWarning(missingContigs, presentContigs.size());
+        warned = true;
+    }
+
+    return feats;
+}
+
+Rcpp::DataFrame QueryCursor::next()
+{
+    std::vector<Feature> feats = read_chunk();
+    switch (command) {
+        case MAP:
+            return synmap->map_features(feats, gid);
+        case COUNT:
+            return synmap->count_features(feats, gid);
+        default:
+            return synmap->search_features(feats, gid);
+    }
+}
+
+void QueryCursor::next(ResultSink& out)
+{
+    std::vector<Feature> feats = read_chunk();
+    switch (command) {
+        case MAP:
+            synmap->map_features(feats, gid, out);
+            break;
+        case COUNT:
+            synmap->count_features(feats, gid, out);
+            break;
+        default:
+            synmap->search_features(feats, gid, out);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef __QUERY_CURSOR_H__
+#define __QUERY_CURSOR_H__
+
+#include "synmap.h"
+#include "line_reader.h"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <Rcpp.h>
+
+/** Run a GFF file against a Synmap a fixed number of features at a time
+ *
+ * Only one chunk of features and its results are held in memory at once, so
+ * memory use does not grow with the size of the GFF. The GFF is memory
+ * mapped, the pages of chunks already searched can be dropped by the OS.
+ *
+ * The Synmap is not owned and must outlive the cursor.
+ */
+class QueryCursor
+{
+private:
+    typedef enum { SEARCH, MAP, COUNT } Command;
+
+    Synmap*    synmap;
+    LineReader fh;
+    Command    command;
+    size_t     chunk_size;
+    size_t     gid;
+    size_t     nfeatures = 0;
+    bool       warned    = false;
+
+    // collected over all chunks, reported once the file is exhausted
+    std::set<std::string> missingContigs;
+    std::set<size_t>      presentContigs;
+
+    // parse the next chunk_size features
+    std::vector<Feature> read_chunk();
+
+public:
+    /** command is one of "search", "map" or "count", gid the genome the GFF
+     * is on (0 or 1, see Synmap::search) */
+    QueryCursor(
+        Synmap*     synmap,
+        std::string gfffile,
+        std::string command,
+        size_t      chunk_size,
+        size_t      gid = 0
+    );
+
+    /** Process the next chunk_size features of the GFF
+     *
+     * Returns the results for the chunk, as Synmap::search, map or count
+     * would return them. Dies at the first chunk with an unparseable line.
+     */
+    Rcpp::DataFrame next();
+
+    /** Process the next chunk_size features, passing the results to out */
+    void next(ResultSink& out);
+
+    /** true once every feature has been processed */
+    bool done() const { return fh.eof(); }
+
+    /** number of features read so far */
+    size_t size() const { return nfeatures; }
+};
+
+#endif
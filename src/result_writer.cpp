@@ -0,0 +1,272 @@
+#include "result_writer.h"
+
+#include <cmath>
+#include <cstring>
+#include <Rcpp.h>
+
+// write out the buffer once it grows past this
+static const size_t BUFFER_SIZE = 1 << 20;
+
+static const char* SEARCH_COLS[] = {
+    "attr", "qseqid", "qstart", "qstop", "tseqid", "tstart", "tstop",
+    "strand", "score", "cset", "l_flag", "r_flag", "inbetween", nullptr
+};
+
+static const char* MAP_COLS[] = {
+    "attr", "qseqid", "qstart", "qstop", "tseqid", "tstart", "tstop",
+    "strand", "missing", nullptr
+};
+
+static const char* COUNT_COLS[] = { "attr", "count", nullptr };
+
+ResultWriter::ResultWriter(
+    std::string filename,
+    std::string command,
+    std::string format,
+    const NameTable& names
+)
+    :
+    m_filename(filename),
+    m_names(names)
+{
+    if (command == "search") {
+        m_table = SEARCH;
+    } else if (command == "map") {
+        m_table = MAP;
+    } else if (command == "count") {
+        m_table = COUNT;
+    } else {
+        Rcpp::stop("Unexpected command '" + command + "', expected search, map or count");
+    }
+
+    if (format == "tsv") {
+        m_binary = false;
+    } else if (format == "bin") {
+        m_binary = true;
+    } else {
+        Rcpp::stop("Unexpected format '" + format + "', expected tsv or bin");
+    }
+
+    m_fh = std::fopen(filename.c_str(), "wb");
+    if (m_fh == nullptr) {
+        Rcpp::stop("Failed to open '" + filename + "' for writing");
+    }
+
+    m_buf.reserve(BUFFER_SIZE + 4096);
+
+    if (m_binary) {
+        put_text("SYNDERRS", 8);
+        put_raw<uint32_t>(1);
+        put_raw<uint32_t>(m_table);
+        put_raw<uint32_t>(m_names.size());
+        for (size_t i = 0; i < m_names.size(); i++) {
+            put_str(m_names.name(i));
+        }
+    } else {
+        const char** cols = m_table == SEARCH ? SEARCH_COLS
+                          : m_table == MAP    ? MAP_COLS
+                          :                     COUNT_COLS;
+        for (size_t i = 0; cols[i] != nullptr; i++) {
+            put_str(cols[i], std::strlen(cols[i]), i == 0);
+        }
+        end_row();
+    }
+}
+
+ResultWriter::~ResultWriter()
+{
+    if (m_fh != nullptr) {
+        std::fwrite(m_buf.data(), 1, m_buf.size(), m_fh);
+        std::fclose(m_fh);
+    }
+}
+
+void ResultWriter::flush()
+{
+    if (!m_buf.empty() && std::fwrite(m_buf.data(), 1, m_buf.size(), m_fh) != m_buf.size()) {
+        Rcpp::stop("Failed to write to '" + m_filename + "'");
+    }
+    m_buf.clear();
+}
+
+void ResultWriter::close()
+{
+    if (m_fh == nullptr) {
+        return;
+    }
+    flush();
+    std::FILE* fh = m_fh;
+    m_fh = nullptr;
+    if (std::fclose(fh) != 0) {
+        Rcpp::stop("Failed to write to '" + m_filename + "'");
+    }
+}
+
+void ResultWriter::put_str(const char* s, size_t len, bool first)
+{
+    if (m_binary) {
+        put_raw<uint32_t>(len);
+    } else if (!first) {
+        m_buf.push_back('\t');
+    }
+    put_text(s, len);
+}
+
+void ResultWriter::put_contig(size_t id)
+{
+    if (m_binary) {
+        put_raw<uint32_t>(id);
+    } else {
+        put_str(m_names.name(id));
+    }
+}
+
+void ResultWriter::put_long(long x)
+{
+    if (m_binary) {
+        put_raw<int64_t>(x);
+    } else {
+        char s[32];
+        int n = std::snprintf(s, sizeof(s), "\t%ld", x);
+        put_text(s, n);
+    }
+}
+
+void ResultWriter::put_int(int x)
+{
+    if (m_binary) {
+        put_raw<int32_t>(x);
+    } else {
+        put_long(x);
+    }
+}
+
+void ResultWriter::put_size(size_t x)
+{
+    if (m_binary) {
+        put_raw<uint64_t>(x);
+    } else {
+        put_long(x);
+    }
+}
+
+void ResultWriter::put_double(double x)
+{
+    if (m_binary) {
+        put_raw<double>(x);
+    } else if (std::isnan(x)) {
+        put_text("\tNA", 3);
+    } else if (std::isinf(x)) {
+        x > 0 ? put_text("\tInf", 4) : put_text("\t-Inf", 5);
+    } else {
+        // as many significant digits as R writes
+        char s[64];
+        int n = std::snprintf(s, sizeof(s), "\t%.15g", x);
+        put_text(s, n);
+    }
+}
+
+void ResultWriter::put_char(char x)
+{
+    if (!m_binary) {
+        m_buf.push_back('\t');
+    }
+    m_buf.push_back(x);
+}
+
+void ResultWriter::put_bool(bool x)
+{
+    if (m_binary) {
+        put_raw<uint8_t>(x);
+    } else {
+        x ? put_text("\tTRUE", 5) : put_text("\tFALSE", 6);
+    }
+}
+
+void ResultWriter::end_row()
+{
+    if (!m_binary) {
+        m_buf.push_back('\n');
+    }
+    if (m_buf.size() >= BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void ResultWriter::add_row(
+    const std::string& t_seqname,
+    size_t      t_qcon,
+    long        t_qstart,
+    long        t_qstop,
+    size_t      t_tcon,
+    long        t_tstart,
+    long        t_tstop,
+    char        t_strand,
+    double      t_score,
+    size_t      t_cset,
+    int         t_l_flag,
+    int         t_r_flag,
+    bool        t_inbetween
+)
+{
+    if (m_table != SEARCH) {
+        ResultSink::add_row(
+            t_seqname, t_qcon, t_qstart, t_qstop, t_tcon, t_tstart, t_tstop,
+            t_strand, t_score, t_cset, t_l_flag, t_r_flag, t_inbetween
+        );
+    }
+    put_str(t_seqname, true);
+    put_contig(t_qcon);
+    put_long(t_qstart + 1);
+    put_long(t_qstop + 1);
+    put_contig(t_tcon);
+    put_long(t_tstart + 1);
+    put_long(t_tstop + 1);
+    put_char(t_strand);
+    put_double(t_score);
+    put_size(t_cset);
+    put_int(t_l_flag);
+    put_int(t_r_flag);
+    put_bool(t_inbetween);
+    end_row();
+}
+
+void ResultWriter::add_row(
+    const std::string& t_seqname,
+    size_t      t_qcon,
+    long        t_qstart,
+    long        t_qstop,
+    size_t      t_tcon,
+    long        t_tstart,
+    long        t_tstop,
+    char        t_strand,
+    bool        t_missing
+)
+{
+    if (m_table != MAP) {
+        ResultSink::add_row(
+            t_seqname, t_qcon, t_qstart, t_qstop, t_tcon, t_tstart, t_tstop,
+            t_strand, t_missing
+        );
+    }
+    put_str(t_seqname, true);
+    put_contig(t_qcon);
+    put_long(t_qstart + 1);
+    put_long(t_qstop + 1);
+    put_contig(t_tcon);
+    put_long(t_tstart + 1);
+    put_long(t_tstop + 1);
+    put_char(t_strand);
+    put_bool(t_missing);
+    end_row();
+}
+
+void ResultWriter::add_row(const std::string& t_seqname, int t_count)
+{
+    if (m_table != COUNT) {
+        ResultSink::add_row(t_seqname, t_count);
+    }
+    put_str(t_seqname, true);
+    put_int(t_count);
+    end_row();
+}
@@ -0,0 +1,125 @@
+#ifndef __RESULT_WRITER_H__
+#define __RESULT_WRITER_H__
+
+#include "types.h"
+#include "name_table.h"
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** A ResultSink that streams rows to a file instead of collecting them
+ *
+ * Rows are formatted into a buffer that is written out whenever it fills, so
+ * memory use does not depend on the number of rows. Positions are written
+ * 1-based, as in the data.frames returned to R. Two formats are supported:
+ *
+ * tsv - a header line with the column names of the matching data.frame
+ *       (see SIType, MapType and CountType) then one TAB-delimited line per
+ *       row. Logicals are written as TRUE/FALSE.
+ *
+ * bin - a compact binary table in native byte order:
+ *
+ *     char[8]   magic, "SYNDERRS"
+ *     uint32    version (1)
+ *     uint32    table, 0 = search, 1 = map, 2 = count
+ *     uint32    number of contig names, then for each
+ *               uint32 length, char[length] name
+ *     rows to the end of the file, with the columns of the data.frame in the
+ *     same order, where attr is a uint32 length then the characters, contigs
+ *     are uint32 indices into the names, positions int64, strand char,
+ *     score double, cset uint64, flags int32, logicals uint8 and count int32
+ *
+ * Only rows of the kind given in the constructor are accepted.
+ */
+class ResultWriter : public ResultSink
+{
+private:
+    typedef enum { SEARCH = 0, MAP = 1, COUNT = 2 } Table;
+
+    std::FILE*        m_fh = nullptr;
+    std::string       m_filename;
+    Table             m_table;
+    bool              m_binary;
+    const NameTable&  m_names;
+    std::vector<char> m_buf;
+
+    // no copies, the destructor closes the file
+    ResultWriter(const ResultWriter&);
+    ResultWriter& operator=(const ResultWriter&);
+
+    void flush();
+
+    // append one field, prefixed by a TAB unless it is the first of a line
+    void put_str(const char* s, size_t len, bool first = false);
+    void put_str(const std::string& s, bool first = false) { put_str(s.data(), s.size(), first); }
+    void put_contig(size_t id);
+    void put_long(long x);
+    void put_int(int x);
+    void put_size(size_t x);
+    void put_double(double x);
+    void put_char(char x);
+    void put_bool(bool x);
+    void end_row();
+
+    template <class T> void put_raw(T x)
+    {
+        const char* p = reinterpret_cast<const char*>(&x);
+        m_buf.insert(m_buf.end(), p, p + sizeof(T));
+    }
+
+    void put_text(const char* s, size_t len)
+    {
+        m_buf.insert(m_buf.end(), s, s + len);
+    }
+
+public:
+    /** command is "search", "map" or "count", format is "tsv" or "bin" */
+    ResultWriter(
+        std::string filename,
+        std::string command,
+        std::string format,
+        const NameTable& names
+    );
+
+    /** Closes the file, errors are only reported by an explicit close() */
+    ~ResultWriter();
+
+    /** Write out everything buffered and close the file, dies on failure */
+    void close();
+
+    using ResultSink::add_row;
+
+    void add_row(
+        const std::string& t_seqname,
+        size_t      t_qcon,
+        long        t_qstart,
+        long        t_qstop,
+        size_t      t_tcon,
+        long        t_tstart,
+        long        t_tstop,
+        char        t_strand,
+        double      t_score,
+        size_t      t_cset,
+        int         t_l_flag,
+        int         t_r_flag,
+        bool        t_inbetween
+    );
+
+    void add_row(
+        const std::string& t_seqname,
+        size_t      t_qcon,
+        long        t_qstart,
+        long        t_qstop,
+        size_t      t_tcon,
+        long        t_tstart,
+        long        t_tstop,
+        char        t_strand,
+        bool        t_missing
+    );
+
+    void add_row(const std::string& t_seqname, int t_count);
+};
+
+#endif
@@ -1,7 +1,95 @@
 #include <string>
+#include <cstring>
 
 #include "global.h"
 #include "synmap.h"
+#include "query_cursor.h"
+#include "result_writer.h"
+
+// Point GFF rows at the columns of a GFF data.frame (seqid, start, stop and
+// attr columns). As for df2rows, the data.frame must outlive the rows.
+static std::vector<FeatureRow> df2features(Rcpp::DataFrame gff)
+{
+    Rcpp::CharacterVector seqid = gff["seqid"];
+    Rcpp::IntegerVector   start = gff["start"];
+    Rcpp::IntegerVector   stop  = gff["stop"];
+    Rcpp::CharacterVector attr  = gff["attr"];
+
+    std::vector<FeatureRow> rows(seqid.size());
+    for (R_xlen_t i = 0; i < seqid.size(); i++) {
+        if (start[i] == NA_INTEGER || stop[i] == NA_INTEGER) {
+            Rcpp::stop("Missing start or stop in GFF row " + std::to_string(i + 1));
+        }
+        if (STRING_ELT(seqid, i) == NA_STRING) {
+            Rcpp::stop("Missing seqid in GFF row " + std::to_string(i + 1));
+        }
+        FeatureRow& row = rows[i];
+        const char* s = CHAR(STRING_ELT(seqid, i));
+        const char* a = CHAR(STRING_ELT(attr, i));
+        row.seqid = Field(s, std::strlen(s));
+        row.start = start[i];
+        row.stop  = stop[i];
+        row.name  = Field(a, std::strlen(a));
+    }
+    return rows;
+}
+
+// Convert a contig length data.frame (seqid and length columns)
+static ContigLengths df2conlen(Rcpp::DataFrame cl)
+{
+    Rcpp::CharacterVector seqid  = cl["seqid"];
+    Rcpp::NumericVector   length = cl["length"];
+
+    ContigLengths out;
+    for (R_xlen_t i = 0; i < seqid.size(); i++) {
+        if (ISNAN(length[i])) {
+            Rcpp::warning("Missing length for contig " + std::string(CHAR(STRING_ELT(seqid, i))));
+            continue;
+        }
+        out.push_back(std::make_pair(std::string(CHAR(STRING_ELT(seqid, i))), (long) length[i]));
+    }
+    return out;
+}
+
+// Point synteny map rows at the columns of a Synmap data.frame. The strings
+// are not copied, so the data.frame must outlive the rows.
+static std::vector<SynmapRow> df2rows(Rcpp::DataFrame syn)
+{
+    Rcpp::CharacterVector qseqid = syn["qseqid"];
+    Rcpp::IntegerVector   qstart = syn["qstart"];
+    Rcpp::IntegerVector   qstop  = syn["qstop"];
+    Rcpp::CharacterVector tseqid = syn["tseqid"];
+    Rcpp::IntegerVector   tstart = syn["tstart"];
+    Rcpp::IntegerVector   tstop  = syn["tstop"];
+    Rcpp::NumericVector   score  = syn["score"];
+    Rcpp::CharacterVector strand = syn["strand"];
+
+    std::vector<SynmapRow> rows(qseqid.size());
+    for (R_xlen_t i = 0; i < qseqid.size(); i++) {
+        if (
+            qstart[i] == NA_INTEGER || qstop[i] == NA_INTEGER ||
+            tstart[i] == NA_INTEGER || tstop[i] == NA_INTEGER
+        ) {
+            Rcpp::stop("Missing position in synteny map row " + std::to_string(i + 1));
+        }
+        if (STRING_ELT(qseqid, i) == NA_STRING || STRING_ELT(tseqid, i) == NA_STRING) {
+            Rcpp::stop("Missing seqid in synteny map row " + std::to_string(i + 1));
+        }
+        SynmapRow& row = rows[i];
+        const char* q = CHAR(STRING_ELT(qseqid, i));
+        const char* t = CHAR(STRING_ELT(tseqid, i));
+        row.seqid[0] = Field(q, std::strlen(q));
+        row.seqid[1] = Field(t, std::strlen(t));
+        row.start[0] = qstart[i];
+        row.stop[0]  = qstop[i];
+        row.start[1] = tstart[i];
+        row.stop[1]  = tstop[i];
+        // Missing scores are taken as 0, missing strands as '+'
+        row.score    = ISNAN(score[i]) ? 0 : score[i];
+        row.strand   = STRING_ELT(strand, i) == NA_STRING ? '+' : CHAR(STRING_ELT(strand, i))[0];
+    }
+    return rows;
+}
 
 //' print all blocks with contiguous set ids
 //'
@@ -123,3 +211,256 @@ Rcpp::DataFrame c_count(
 
     return synmap.count(gff);
 }
+
+//' build a synteny map once and return a handle to it
+//'
+//' The returned external pointer keeps the fully linked Synmap (merged
+//' blocks, contiguous sets and interval trees) alive between calls, so many
+//' queries can be run against one map without rebuilding it.
+//'
+//' @param syn      synteny map file name
+//' @param tcl      target contig lengths file name
+//' @param qcl      query contig lengths file name
+//' @param swap     reverse direction of synteny map (e.g. swap query and target) 
+//' @param k        match fuziness, integer
+//' @param r        score decay rate, 0 means no context, high means more context
+//' @param trans    score transform methods, single character
+//' @param offsets  4-element integer vector of [01] offsets (start/stop
+//'                 offsets for the synteny maps and the GFF)
+//' @param threads  number of threads used to parse and link the synteny map
+//'                 and to run queries on it
+// [[Rcpp::export]]
+Rcpp::XPtr<Synmap> c_load_synmap(
+    std::string syn,
+    std::string tcl,
+    std::string qcl,
+    bool swap,
+    int k,
+    double r,
+    char trans,
+    std::vector<int> offsets,
+    int threads
+)
+{
+    if (threads < 1) {
+        Rcpp::stop("threads must be a positive integer");
+    }
+    Synmap* synmap = new Synmap(syn, tcl, qcl, swap, k, r, trans, offsets, threads);
+
+    return Rcpp::XPtr<Synmap>(synmap, true);
+}
+
+//' build a synteny map from data.frames and return a handle to it
+//'
+//' Like c_load_synmap, but the map is built straight from the columns of
+//' data.frames already loaded in R, no files are written or parsed.
+//'
+//' @param syn      Synmap data.frame (qseqid, qstart, qstop, tseqid, tstart,
+//'                 tstop, score and strand columns)
+//' @param tcl      target contig lengths data.frame (seqid and length columns)
+//' @param qcl      query contig lengths data.frame (seqid and length columns)
+//' @param swap     reverse direction of synteny map (e.g. swap query and target) 
+//' @param k        match fuziness, integer
+//' @param r        score decay rate, 0 means no context, high means more context
+//' @param trans    score transform methods, single character
+//' @param offsets  2-element integer vector of [01] start/stop offsets for
+//'                 the synteny map
+//' @param threads  number of threads used to link the synteny map and to run
+//'                 queries on it
+// [[Rcpp::export]]
+Rcpp::XPtr<Synmap> c_load_synmap_df(
+    Rcpp::DataFrame syn,
+    Rcpp::DataFrame tcl,
+    Rcpp::DataFrame qcl,
+    bool swap,
+    int k,
+    double r,
+    char trans,
+    std::vector<int> offsets,
+    int threads
+)
+{
+    if (threads < 1) {
+        Rcpp::stop("threads must be a positive integer");
+    }
+    Synmap* synmap = new Synmap(
+        df2rows(syn), df2conlen(tcl), df2conlen(qcl), swap, k, r, trans, offsets, threads
+    );
+
+    return Rcpp::XPtr<Synmap>(synmap, true);
+}
+
+//' print all blocks of a loaded synteny map with contiguous set ids
+//'
+//' @param synmap  handle returned by c_load_synmap
+//' @param reverse query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+Rcpp::DataFrame c_handle_dump(Rcpp::XPtr<Synmap> synmap, bool reverse)
+{
+    return synmap->as_data_frame(reverse ? 1 : 0);
+}
+
+//' predict search intervals on a loaded synteny map
+//'
+//' @param synmap  handle returned by c_load_synmap
+//' @param gff     GFF data.frame (seqid, start, stop and attr columns)
+//' @param reverse query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+Rcpp::DataFrame c_handle_search(Rcpp::XPtr<Synmap> synmap, Rcpp::DataFrame gff, bool reverse)
+{
+    return synmap->search(df2features(gff), reverse ? 1 : 0);
+}
+
+//' remove links that disagree with a loaded synteny map
+//'
+//' @param synmap  handle returned by c_load_synmap
+//' @param hit     int file name
+//' @param reverse query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+Rcpp::CharacterVector c_handle_filter(Rcpp::XPtr<Synmap> synmap, std::string hit, bool reverse)
+{
+    return synmap->filter(hit, reverse ? 1 : 0);
+}
+
+//' trace intervals across genomes on a loaded synteny map
+//'
+//' @param synmap  handle returned by c_load_synmap
+//' @param gff     GFF data.frame (seqid, start, stop and attr columns)
+//' @param reverse query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+Rcpp::DataFrame c_handle_map(Rcpp::XPtr<Synmap> synmap, Rcpp::DataFrame gff, bool reverse)
+{
+    return synmap->map(df2features(gff), reverse ? 1 : 0);
+}
+
+//' count overlaps on a loaded synteny map
+//'
+//' @param synmap  handle returned by c_load_synmap
+//' @param gff     GFF data.frame (seqid, start, stop and attr columns)
+//' @param reverse query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+Rcpp::DataFrame c_handle_count(Rcpp::XPtr<Synmap> synmap, Rcpp::DataFrame gff, bool reverse)
+{
+    return synmap->count(df2features(gff), reverse ? 1 : 0);
+}
+
+//' load a synteny map from a binary cache
+//'
+//' @param cache   cache file name, as written by c_handle_write_cache
+//' @param threads number of threads used to run queries on the synteny map
+// [[Rcpp::export]]
+Rcpp::XPtr<Synmap> c_load_cache(std::string cache, int threads)
+{
+    if (threads < 1) {
+        Rcpp::stop("threads must be a positive integer");
+    }
+    Synmap* synmap = new Synmap(cache, threads);
+
+    return Rcpp::XPtr<Synmap>(synmap, true);
+}
+
+//' write a loaded synteny map to a binary cache
+//'
+//' @param synmap  handle returned by c_load_synmap or c_load_cache
+//' @param cache   cache file name
+// [[Rcpp::export]]
+void c_handle_write_cache(Rcpp::XPtr<Synmap> synmap, std::string cache)
+{
+    synmap->write_cache(cache);
+}
+
+//' get the parameters a loaded synteny map was built with
+//'
+//' @param synmap  handle returned by c_load_synmap or c_load_cache
+// [[Rcpp::export]]
+Rcpp::List c_handle_parameters(Rcpp::XPtr<Synmap> synmap)
+{
+    return synmap->parameters();
+}
+
+//' change k, r and the score transform of a loaded synteny map in place
+//'
+//' @param synmap  handle returned by c_load_synmap or c_load_cache
+//' @param k       match fuziness, integer
+//' @param r       score decay rate
+//' @param trans   score transform method, single character
+// [[Rcpp::export]]
+void c_handle_reconfigure(Rcpp::XPtr<Synmap> synmap, int k, double r, char trans)
+{
+    synmap->reconfigure(k, r, trans);
+}
+
+//' open a cursor that runs a GFF file against a loaded synteny map in chunks
+//'
+//' @param synmap      handle returned by c_load_synmap or c_load_cache
+//' @param gff         GFF file name
+//' @param command     one of "search", "map" or "count"
+//' @param chunk_size  number of GFF features processed per chunk
+//' @param reverse     query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+Rcpp::XPtr<QueryCursor> c_handle_cursor(
+    Rcpp::XPtr<Synmap> synmap,
+    std::string gff,
+    std::string command,
+    int chunk_size,
+    bool reverse
+)
+{
+    if (chunk_size < 1) {
+        Rcpp::stop("chunk_size must be a positive integer");
+    }
+    QueryCursor* cursor = new QueryCursor(synmap.get(), gff, command, chunk_size, reverse ? 1 : 0);
+
+    // the cursor protects the synmap handle, so the map stays alive for as
+    // long as the cursor does
+    return Rcpp::XPtr<QueryCursor>(cursor, true, R_NilValue, synmap);
+}
+
+//' get the results for the next chunk of a cursor
+//'
+//' @param cursor  cursor returned by c_handle_cursor
+// [[Rcpp::export]]
+Rcpp::DataFrame c_cursor_next(Rcpp::XPtr<QueryCursor> cursor)
+{
+    return cursor->next();
+}
+
+//' check whether all features of a cursor have been processed
+//'
+//' @param cursor  cursor returned by c_handle_cursor
+// [[Rcpp::export]]
+bool c_cursor_done(Rcpp::XPtr<QueryCursor> cursor)
+{
+    return cursor->done();
+}
+
+//' run a GFF file against a loaded synteny map, writing results to a file
+//'
+//' @param synmap      handle returned by c_load_synmap or c_load_cache
+//' @param gff         GFF file name
+//' @param out         output file name
+//' @param command     one of "search", "map" or "count"
+//' @param format      one of "tsv" or "bin" (see ResultWriter)
+//' @param chunk_size  number of GFF features processed at a time
+//' @param reverse     query from the target genome, see flip_synmap
+// [[Rcpp::export]]
+void c_handle_write(
+    Rcpp::XPtr<Synmap> synmap,
+    std::string gff,
+    std::string out,
+    std::string command,
+    std::string format,
+    int chunk_size,
+    bool reverse
+)
+{
+    if (chunk_size < 1) {
+        Rcpp::stop("chunk_size must be a positive integer");
+    }
+    QueryCursor cursor(synmap.get(), gff, command, chunk_size, reverse ? 1 : 0);
+    ResultWriter writer(out, command, format, synmap->contig_names());
+    while (!cursor.done()) {
+        cursor.next(writer);
+    }
+    writer.close();
+}
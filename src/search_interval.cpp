@@ -1,21 +1,30 @@
 #include "search_interval.h"
 
+#include <algorithm>
+#include <cmath>
+
 SearchInterval::SearchInterval(
-    const std::array<Block*,2>& t_ends,
+    const BlockTable& t_blocks,
+    uint32_t t_cset,
     Feature* t_feat,
     bool t_inbetween,
     double r
 )
-    : m_feat(t_feat),
+    : m_blocks(&t_blocks),
+      m_feat(t_feat),
       m_inbetween(t_inbetween),
-      m_bnds(t_ends)
+      m_bnds({{ t_blocks.cset_ends[0][t_cset], t_blocks.cset_ends[1][t_cset] }}),
+      m_cset(t_cset),
+      m_mbrs({{ t_blocks.cset_members[t_cset], t_blocks.cset_members[t_cset + 1] - 1 }})
 {
-    m_score = calculate_score(m_bnds[0], r);
+    m_score = r == t_blocks.score_r
+            ? sum_score(t_cset, r)
+            : calculate_score(m_bnds[0], r);
 
     reduce_side(LO);
     reduce_side(HI);
 
-    m_inverted = m_bnds[0]->over->strand == '-';
+    m_inverted = m_blocks->over_strand(m_bnds[0]) == '-';
 
     get_si_bound(LO);
     get_si_bound(HI);
@@ -26,33 +35,46 @@ SearchInterval::~SearchInterval() { }
 
 bool SearchInterval::feature_overlap(Feature* other)
 {
-    bool same_contig = other->parent_name == m_bnds[0]->over->parent->name;
+    bool same_contig = other->parent_id == m_blocks->contig[m_blocks->over[m_bnds[0]]];
     bool search_interval_overlap = overlap(other);
     return search_interval_overlap && same_contig;
 }
 
 void SearchInterval::reduce_side(const Direction d){
-    while(m_bnds[d]->cnr[!d] != nullptr && REL_GT(m_bnds[d]->cnr[!d]->pos[d], m_feat->pos[d], d)){
-        m_bnds[d] = m_bnds[d]->cnr[!d];
+    // Members are sorted by start and, since they are disjoint, by stop. Find
+    // the innermost member of the set whose inner neighbor does not pass the
+    // query edge, as if walking in from the end of the set.
+    const BlockTable& blk = *m_blocks;
+    const long* pos = blk.member_pos[d].data();
+    uint32_t first = blk.cset_members[m_cset];
+    uint32_t last  = blk.cset_members[m_cset + 1];
+    if (d == LO) {
+        // the member before the first member starting at or after the query
+        m_mbrs[d] = std::lower_bound(pos + first + 1, pos + last, m_feat->pos[d]) - pos - 1;
+    } else {
+        // the first member stopping after the query
+        m_mbrs[d] = std::upper_bound(pos + first, pos + last - 1, m_feat->pos[d]) - pos;
     }
+    m_bnds[d] = blk.member[m_mbrs[d]];
 }
 
-void SearchInterval::add_row(SIType& stype) {
+void SearchInterval::add_row(ResultSink& stype) {
+    uint32_t over = m_blocks->over[m_bnds[0]];
     stype.add_row(
-                                        // Output column ids:
-         m_feat->name,                  //  1
-         m_feat->parent_name,           //  2
-         m_feat->start(),               //  3
-         m_feat->stop(),                //  4
-         m_bnds[0]->over->parent->name, //  5
-         start(),                       //  6
-         stop(),                        //  7
-         m_bnds[0]->over->strand,       //  8
-         m_score,                       //  9
-         m_bnds[0]->cset->id,           // 10
-         m_flag[0],                     // 11
-         m_flag[1],                     // 12
-         m_inbetween                    // 13
+                                           // Output column ids:
+         m_feat->name,                     //  1
+         m_feat->parent_id,                //  2
+         m_feat->start(),                  //  3
+         m_feat->stop(),                   //  4
+         m_blocks->contig[over],           //  5
+         start(),                          //  6
+         stop(),                           //  7
+         m_blocks->over_strand(m_bnds[0]), //  8
+         m_score,                          //  9
+         m_blocks->cset_id[m_blocks->cset[m_bnds[0]]], // 10
+         m_flag[0],                        // 11
+         m_flag[1],                        // 12
+         m_inbetween                       // 13
     );
 }
 
@@ -68,7 +90,9 @@ void SearchInterval::get_si_bound(const Direction d)
 
     long q = m_feat->pos[d];
 
-    const auto& set_bounds = m_bnds[0]->cset->pos;
+    const BlockTable& blk = *m_blocks;
+
+    long set_bounds[2] = { blk.cset_pos[0][m_cset], blk.cset_pos[1][m_cset] };
 
     // All diagrams are shown for the d=HI case, take the mirror image fr d=LO.
     //
@@ -86,10 +110,16 @@ void SearchInterval::get_si_bound(const Direction d)
     //                 ^        ^    ^        ^    ^                ^
 
     // Positions of a, b, c, and d (as shown above)
-    long pnt_a = m_bnds[!d]->pos[!d];
-    long pnt_b = m_bnds[!d]->pos[ d];
-    long pnt_c = m_bnds[ d]->pos[!d];
-    long pnt_d = m_bnds[ d]->pos[ d];
+    long pnt_a = blk.member_pos[!d][m_mbrs[!d]];
+    long pnt_b = blk.member_pos[ d][m_mbrs[!d]];
+    long pnt_c = blk.member_pos[!d][m_mbrs[ d]];
+    long pnt_d = blk.member_pos[ d][m_mbrs[ d]];
+
+    // positions of the homologs of the bounding blocks on the target
+    long lo_over[2] = { blk.member_over_pos[0][m_mbrs[!d]], blk.member_over_pos[1][m_mbrs[!d]] };
+    long hi_over[2] = { blk.member_over_pos[0][m_mbrs[ d]], blk.member_over_pos[1][m_mbrs[ d]] };
+    // the homolog of the outer bounding block
+    uint32_t over_hi = blk.over[m_bnds[d]];
 
 
     // This may occur when there is only one element in the ContiguousSet
@@ -99,7 +129,7 @@ void SearchInterval::get_si_bound(const Direction d)
     //   <---q
     // q < x
     if(REL_LT(q, set_bounds[!d], d)) {
-        bound = m_bnds[!d]->over->pos[!vd];
+        bound = lo_over[!vd];
         flag = UNBOUND;
     }
 
@@ -108,7 +138,7 @@ void SearchInterval::get_si_bound(const Direction d)
     //              --q
     // q < a
     else if(REL_LT(q, pnt_a, d)) {
-        bound = m_bnds[!d]->over->pos[!vd];
+        bound = lo_over[!vd];
         flag = BOUND;
     }
 
@@ -117,7 +147,7 @@ void SearchInterval::get_si_bound(const Direction d)
     //        <---q
     // q < b
     else if(REL_LE(q, pnt_b, d)) {
-        bound = m_bnds[!d]->over->pos[vd];
+        bound = lo_over[vd];
         flag = ANCHORED;
     }
 
@@ -127,7 +157,7 @@ void SearchInterval::get_si_bound(const Direction d)
     // q < c && q > b
     //   (q > b test required since m_bnds[LO] can equal m_bnds[HI])
     else if(REL_LT(q, pnt_c, d) && REL_GT(q, pnt_b, d)) {
-        bound = m_bnds[d]->over->pos[!vd];
+        bound = hi_over[!vd];
         flag = BOUND;
     }
 
@@ -136,7 +166,7 @@ void SearchInterval::get_si_bound(const Direction d)
     //             <--------------q
     // q < d
     else if(REL_LE(q, pnt_d, d)) {
-        bound = m_bnds[d]->over->pos[vd];
+        bound = hi_over[vd];
         flag = ANCHORED;
     }
 
@@ -145,7 +175,7 @@ void SearchInterval::get_si_bound(const Direction d)
     //              <----------------------q
     // q < y, (which implies there is a node after d)
     else if(REL_LE(q, set_bounds[d], d)) {
-        bound = m_bnds[d]->cnr[d]->over->pos[!vd];
+        bound = blk.member_over_pos[!vd][d ? m_mbrs[d] + 1 : m_mbrs[d] - 1];
         flag = BOUND;
     }
 
@@ -153,24 +183,24 @@ void SearchInterval::get_si_bound(const Direction d)
     // In this case, the hi and lo Contiguous nodes will be the same
     else {
         // Get nearest non-overlapping sequence
-        Block* downstream_blk = m_bnds[d]->over->corner_adj(vd);
+        uint32_t downstream_blk = blk.adj[vd][over_hi];
 
         // adjacent block on TARGET side exists
         //    |x...--a=======b|
         //    |x...--c=======d|  ...  F===
         //                           ^
         //                    <---q
-        if(downstream_blk != nullptr) {
+        if(downstream_blk != BlockTable::NONE) {
             flag = UNBOUND;
-            bound = downstream_blk->pos[!vd];
+            bound = blk.pos[!vd][downstream_blk];
         }
         //    |x...--a=======b|
         //    |x...--c=======d|  ...  THE_END
         //                    <---q
         // query is further out than ANYTHING in the synteny map
         else {
-            bound = vd ? m_bnds[d]->over->parent->parent_length - 1 : 0;
-            flag = m_bnds[d]->over->pos[vd] == bound ? EXTREME : BEYOND;
+            bound = vd ? blk.contig_length[blk.contig[over_hi]] - 1 : 0;
+            flag = hi_over[vd] == bound ? EXTREME : BEYOND;
         }
     }
 
@@ -220,25 +250,28 @@ double SearchInterval::flank_area(long near, long far, double r)
     return area;
 }
 
-double SearchInterval::calculate_score(Block* b, double r)
+double SearchInterval::calculate_score(uint32_t b, double r)
 {
 
     double score = 0;
 
-    if(b == nullptr)
+    if(b == BlockTable::NONE)
         return score;
 
+    const BlockTable& blk = *m_blocks;
+
     // rewind
-    while(b->cnr[0] != nullptr) {
-        b = b->cnr[0];
+    while(blk.cnr[0][b] != BlockTable::NONE) {
+        b = blk.cnr[0][b];
     }
 
     Feature* a  = m_feat;
     long     a1 = a->start();
+    long     a2 = a->stop();
 
-    for(; b != nullptr ; b = b->cnr[1]) {
-        long b1 = b->start();
-        long b2 = b->stop();
+    for(; b != BlockTable::NONE ; b = blk.cnr[1][b]) {
+        long b1 = blk.pos[0][b];
+        long b2 = blk.pos[1][b];
 
         //               a1        a2
         //      b1  b2   |=========|    query interval
@@ -263,7 +296,8 @@ double SearchInterval::calculate_score(Block* b, double r)
                           //             b1    |     b1
                           //             |-----|         overlapping interval
                           //             i1    i2
-                          a->overlap_length(b);
+                          // (as Interval::overlap_length)
+                          (a1 <= b2 && b1 <= a2 ? std::min(a2, b2) - std::max(a1, b1) + 1 : 0);
 
         // NOTE: I am kind of adding length to area here, but it actually
         // works. `_flank_area` returns the area of a segment of the base
@@ -273,9 +307,68 @@ double SearchInterval::calculate_score(Block* b, double r)
         // overlapping segment length by the score, gives the overlapping
         // segmental score.
 
-        long actual_length = b->pos[1] - b->pos[0] + 1;
+        long actual_length = b2 - b1 + 1;
 
-        score += b->score * weighted_length / actual_length;
+        score += blk.score[b] * weighted_length / actual_length;
     }
     return score;
 }
+
+double SearchInterval::block_score(uint32_t b, double r)
+{
+    const BlockTable& blk = *m_blocks;
+
+    long a1 = m_feat->start();
+    long a2 = m_feat->stop();
+    long b1 = blk.pos[0][b];
+    long b2 = blk.pos[1][b];
+
+    // as in calculate_score
+    double weighted_length = flank_area(a1 - b2, a1 - b1, r) +
+                             flank_area(b1 - a1, b2 - a1, r) +
+                             (a1 <= b2 && b1 <= a2 ? std::min(a2, b2) - std::max(a1, b1) + 1 : 0);
+
+    return blk.score[b] * weighted_length / (b2 - b1 + 1);
+}
+
+double SearchInterval::sum_score(uint32_t cset, double r)
+{
+    const BlockTable& blk = *m_blocks;
+
+    long a1 = m_feat->start();
+    long a2 = m_feat->stop();
+
+    const long* start = blk.member_pos[0].data();
+    const long* stop  = blk.member_pos[1].data();
+    uint32_t first = blk.cset_members[cset];
+    uint32_t last  = blk.cset_members[cset + 1];
+
+    // members are disjoint, so [first, lo) stop before a1, [hi, last) start
+    // after it and at most one member in between contains it
+    uint32_t lo = std::lower_bound(stop + first, stop + last, a1) - stop;
+    uint32_t hi = std::upper_bound(start + lo, start + last, a1) - start;
+
+    double score = 0;
+    if (lo > first) {
+        score += blk.member_flank[0][lo - 1] * std::exp(-r * (a1 - stop[lo - 1]));
+    }
+    if (hi < last) {
+        score += blk.member_flank[1][hi] * std::exp(-r * (start[hi] - a1));
+    }
+    for (uint32_t m = lo; m < hi; m++) {
+        score += block_score(blk.member[m], r);
+    }
+
+    // the members after a1 also score their overlap with the query, which
+    // is their whole length up to the last one stopping by a2
+    uint32_t in = std::upper_bound(stop + hi, stop + last, a2) - stop;
+    if (in > hi) {
+        score += blk.member_score[in - 1] - (hi > first ? blk.member_score[hi - 1] : 0);
+    }
+    if (in < last && start[in] <= a2) {
+        score += blk.score[blk.member[in]] * (a2 - start[in] + 1) / (stop[in] - start[in] + 1);
+    }
+
+    return score;
+}
+
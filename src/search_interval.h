@@ -6,6 +6,7 @@
 #include "feature.h"
 #include "block.h"
 #include "contiguous_set.h"
+#include "block_table.h"
 #include "types.h"
 
 enum Flag {
@@ -20,9 +21,14 @@ class SearchInterval : Interval<SearchInterval>
 {
 private:
 
-    Feature*             m_feat      = nullptr;
-    bool                 m_inbetween = false;
-    std::array<Block*,2> m_bnds      = {{ nullptr }};
+    // rows of m_bnds refer to this table
+    const BlockTable*       m_blocks    = nullptr;
+    Feature*                m_feat      = nullptr;
+    bool                    m_inbetween = false;
+    std::array<uint32_t,2>  m_bnds      = {{ BlockTable::NONE, BlockTable::NONE }};
+    // the contiguous set and the member indices (see BlockTable) of m_bnds
+    uint32_t                m_cset      = BlockTable::NONE;
+    std::array<uint32_t,2>  m_mbrs      = {{ BlockTable::NONE, BlockTable::NONE }};
     double               m_score     = 0;
     std::array<int,2>    m_flag      = {{ 404 }};
     bool                 m_inverted  = false;
@@ -32,11 +38,21 @@ private:
 
     void set_bound(Direction d);
     double flank_area(long near, long far, double r);
-    double calculate_score(Block* blk, double r);
+    double calculate_score(uint32_t blk, double r);
+    // the score one block adds, as in calculate_score
+    double block_score(uint32_t b, double r);
+    // calculate_score from the score sums of the BlockTable, for its r
+    double sum_score(uint32_t cset, double r);
 
 public:
+    /** Build the search interval of a feature in one contiguous set
+     *
+     * @param t_blocks the frozen blocks of the synteny map
+     * @param t_cset   row of the contiguous set in t_blocks
+     */
     SearchInterval(
-        const std::array<Block*,2>& t_ends,
+        const BlockTable& t_blocks,
+        uint32_t t_cset,
         Feature* t_feat,
         bool t_inbetween,
         double t_r
@@ -52,7 +68,7 @@ public:
 
     bool feature_overlap(Feature* other);
 
-    void add_row(SIType& stype);
+    void add_row(ResultSink& stype);
 
 };
 
@@ -0,0 +1,10 @@
+#ifndef __SYNDER_TYPES_H__
+#define __SYNDER_TYPES_H__
+
+// Included by RcppExports.cpp so exported functions may take or return
+// external pointers to synder classes
+
+#include "synmap.h"
+#include "query_cursor.h"
+
+#endif
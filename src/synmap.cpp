@@ -1,5 +1,8 @@
 #include "synmap.h"
 
+// Queries are run in chunks of this many features, see run_features
+static const size_t QUERY_CHUNK = 1 << 10;
+
 Synmap::Synmap(
     std::string t_synfile,
     std::string t_tclfile,
@@ -8,7 +11,8 @@ Synmap::Synmap(
     int    t_k,
     double t_r,
     char   t_trans,
-    std::vector<int> t_offsets
+    std::vector<int> t_offsets,
+    size_t t_threads
 )
     :
     synfile(t_synfile),
@@ -17,7 +21,8 @@ Synmap::Synmap(
     swap(t_swap),
     k(t_k),
     r(t_r),
-    trans(t_trans)
+    trans(t_trans),
+    threads(t_threads)
 {
     if(t_offsets.size() != 2) {
         Rcpp::stop(
@@ -29,8 +34,71 @@ Synmap::Synmap(
     offsets[1] = t_offsets[1]; // synmap stop offset
     load_blocks();
     validate();
+    block_table.build(genome[0], genome[1], r);
 }
 
+Synmap::Synmap(
+    const std::vector<SynmapRow>& rows,
+    const ContigLengths& tcl,
+    const ContigLengths& qcl,
+    bool   t_swap,
+    int    t_k,
+    double t_r,
+    char   t_trans,
+    std::vector<int> t_offsets,
+    size_t t_threads
+)
+    :
+    swap(t_swap),
+    k(t_k),
+    r(t_r),
+    trans(t_trans),
+    threads(t_threads)
+{
+    if(t_offsets.size() != 2) {
+        Rcpp::stop(
+            "Offsets must be an integer vector of 2 elements"
+            "(the start and stop offsets for the synteny map)"
+        );
+    }
+    offsets[0] = t_offsets[0]; // synmap start offset
+    offsets[1] = t_offsets[1]; // synmap stop offset
+
+    check_trans(trans);
+
+    genome[0] = new Genome("Q", &names);
+    genome[1] = new Genome("T", &names);
+
+    size_t i = swap ? 1 : 0;
+    size_t j = swap ? 0 : 1;
+
+    std::vector<SynmapRow> blocks(rows.size());
+    for (size_t n = 0; n < rows.size(); n++) {
+        const SynmapRow& row = rows[n];
+        SynmapRow& blk = blocks[n];
+        blk.seqid[i] = row.seqid[0]; blk.start[i] = row.start[0]; blk.stop[i] = row.stop[0];
+        blk.seqid[j] = row.seqid[1]; blk.start[j] = row.start[1]; blk.stop[j] = row.stop[1];
+        blk.score  = row.score;
+        blk.strand = row.strand;
+        offset_row(blk);
+    }
+    add_blocks(blocks);
+
+    genome[i]->set_contig_lengths(qcl);
+    genome[j]->set_contig_lengths(tcl);
+
+    link_blocks();
+    validate();
+    block_table.build(genome[0], genome[1], r);
+}
+
+Synmap::Synmap(std::string cachefile, size_t t_threads)
+    : threads(t_threads)
+{
+    SynmapCache::read(*this, cachefile);
+    validate();
+    block_table.build(genome[0], genome[1], r);
+}
 
 Synmap::~Synmap()
 {
@@ -39,109 +107,264 @@ Synmap::~Synmap()
 }
 
 
-void Synmap::load_blocks()
-{
+std::string listToString(std::set<std::string> items, const char* delim){
+    std::stringstream itemStr;
+    std::copy(
+        items.begin(),
+        items.end(),
+        std::ostream_iterator<std::string>(itemStr, delim)
+    );
+    return itemStr.str();
+}
 
-    std::ifstream fh(synfile);
+void missingContigWarning(std::set<std::string> missing, int ntotal){
+    if(missing.size() > 0){
+        Rcpp::warning(
+            std::to_string(missing.size())                                    +
+            " out of "                                                        +
+            std::to_string(ntotal + missing.size())                           +
+            " contigs in the query GFF are missing in the synteny map. "      +
+            "It is not unusual for some contigs (scaffolds) to be missing.\n" +
+            "Missing items: [" + listToString(missing, ", ") + "]\n"
+        );
+    }
+}
 
-    genome[0] = new Genome("Q");
-    genome[1] = new Genome("T");
+void dieOnfailingLines(std::vector<std::string> lines){
+    if(lines.size() > 0){
+
+        std::vector<std::string>::const_iterator begin = lines.begin();
+        std::vector<std::string>::const_iterator end
+            = lines.size() > 10
+            ? lines.begin() + 10
+            : lines.end();
 
-    // Contig name
-    std::array< std::string, 2 > seqid;
-    double score;
-    char   strand;
-    long   start[2], stop[2];
+        std::string introStr 
+            = lines.size() > 10
+            ? "First 10 failing lines:\n"
+            : "Failing lines:\n";
 
-    Block *qblk, *tblk;
+        std::stringstream itemStr;
+        std::copy(begin, end, std::ostream_iterator<std::string>(itemStr, "\n"));
 
+        Rcpp::stop(
+            "Failed to parse ",
+            std::to_string(lines.size()),
+            "lines. ", introStr,
+            itemStr.str()
+        );
+    }
+}
+
+bool Synmap::parse_block_row(LineReader& fh, SynmapRow& row) const
+{
     size_t i = swap ? 1 : 0;
     size_t j = swap ? 0 : 1;
 
-    std::string line;
-    while (std::getline(fh, line)) {
-
-        // skip comments
-        if (line[0] == '#')
-            continue;
+    if (!(
+        fh.read(row.seqid[i]) && fh.read(row.start[i]) && fh.read(row.stop[i]) &&
+        fh.read(row.seqid[j]) && fh.read(row.start[j]) && fh.read(row.stop[j])
+    )) {
+        return false;
+    }
 
-        std::istringstream row(line);
-
-        row >> seqid[i] >> start[i] >> stop[i]
-            >> seqid[j] >> start[j] >> stop[j]
-            >> score >> strand;
-
-        start[0] -= offsets[0];
-        start[1] -= offsets[0];
-        stop[0]  -= offsets[1];
-        stop[1]  -= offsets[1];
-
-        switch (trans) {
-            case 'l':
-                // l := -log(S) (e-values or p-values)\n"
-                score = -1 * std::log(score);
-                break;
-            case 'd':
-                // d := L * S (score densities)\n"
-                score = score * std::min((stop[0] - start[0] + 1), (stop[1] - start[1] + 1));
-                break;
-            case 'p':
-                // p := L * S / 100 (percent identity)\n"
-                score = score * std::min((stop[0] - start[0] + 1), (stop[1] - start[1] + 1)) / 100.0;
-                break;
-            case 'i':
-                // i := S  (default, no transformation)\n"
-                // no transformation
-                break;
-            default:
-                Rcpp::stop("Unexpected value of transform (trans argument)");
-                break;
-        }
+    // Missing scores (e.g. NA) are taken as 0, missing strands as '+'
+    if (!fh.read(row.score))
+        row.score = 0;
+    if (!fh.read(row.strand))
+        row.strand = '+';
 
-        qblk = genome[0]->add_block(seqid[0], start[0], stop[0], score, '+');
-        tblk = genome[1]->add_block(seqid[1], start[1], stop[1], score, strand);
+    offset_row(row);
+    return true;
+}
 
-        // link homologs
-        LinkedInterval<Block>::link_homologs(qblk, tblk);
+bool Synmap::is_trans(char trans)
+{
+    return trans == 'i' || trans == 'd' || trans == 'p' || trans == 'l';
+}
 
+void Synmap::check_trans(char trans)
+{
+    if (!is_trans(trans)) {
+        Rcpp::stop("Unexpected value of transform (trans argument)");
     }
+}
 
-    link_blocks();
+void Synmap::offset_row(SynmapRow& row) const
+{
+    row.start[0] -= offsets[0];
+    row.start[1] -= offsets[0];
+    row.stop[0]  -= offsets[1];
+    row.stop[1]  -= offsets[1];
 }
 
-Rcpp::DataFrame Synmap::as_data_frame()
+double Synmap::transform_score(double score, long length) const
 {
-    return genome[0]->as_data_frame();
+    switch (trans) {
+        case 'l':
+            // l := -log(S) (e-values or p-values)
+            return -1 * std::log(score);
+        case 'd':
+            // d := L * S (score densities)
+            return score * length;
+        case 'p':
+            // p := L * S / 100 (percent identity)
+            return score * length / 100.0;
+        default:
+            // i := S  (default, no transformation)
+            return score;
+    }
 }
 
-void Synmap::link_blocks()
+void Synmap::parse_block_chunk(const char* begin, const char* end, SynmapChunk& chunk) const
+{
+    LineReader fh(begin, end);
+    SynmapRow row;
+    while (fh.next_line()) {
+        // skip comments and empty lines
+        if (fh.is_comment() || fh.is_blank())
+            continue;
+        if (parse_block_row(fh, row)) {
+            chunk.rows.push_back(row);
+        } else {
+            chunk.failing.push_back(fh.line());
+        }
+    }
+}
+
+void Synmap::load_blocks()
 {
 
+    check_trans(trans);
+
+    MappedFile file(synfile);
+
+    genome[0] = new Genome("Q", &names);
+    genome[1] = new Genome("T", &names);
+
+    // Each thread gets at least MIN_CHUNK bytes, smaller files are read in
+    // one piece on the calling thread
+    const size_t MIN_CHUNK = 1 << 20;
+    size_t nchunks = std::max<size_t>(1, std::min<size_t>(threads, file.size() / MIN_CHUNK));
+
+    std::vector< std::pair<const char*, const char*> > bounds =
+        LineReader::chunks(file.data(), file.size(), nchunks);
+
+    // Parse the chunks into separate buffers. The workers only touch their
+    // own chunk, no R API may be called from them.
+    std::vector<SynmapChunk> chunks(bounds.size());
+    if (chunks.size() == 1) {
+        parse_block_chunk(bounds[0].first, bounds[0].second, chunks[0]);
+    } else if (chunks.size() > 1) {
+        std::vector<std::exception_ptr> errors(chunks.size());
+        std::vector<std::thread> workers;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            workers.push_back(std::thread([&, c]() {
+                try {
+                    parse_block_chunk(bounds[c].first, bounds[c].second, chunks[c]);
+                } catch (...) {
+                    errors[c] = std::current_exception();
+                }
+            }));
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        for (auto& e : errors) {
+            if (e) std::rethrow_exception(e);
+        }
+    }
+
+    // Merge in file order, so blocks get the same ids as a serial load
+    std::vector<std::string> failingLines;
+    for (auto& chunk : chunks) {
+        add_blocks(chunk.rows);
+        failingLines.insert(failingLines.end(), chunk.failing.begin(), chunk.failing.end());
+        std::vector<SynmapRow>().swap(chunk.rows);
+    }
+
+    dieOnfailingLines(failingLines);
+
     size_t i = swap ? 1 : 0;
     size_t j = swap ? 0 : 1;
 
     genome[i]->set_contig_lengths(qclfile);
     genome[j]->set_contig_lengths(tclfile);
 
-    genome[0]->link_block_corners();
-    genome[1]->link_block_corners();
+    link_blocks();
+}
+
+void Synmap::add_blocks(const std::vector<SynmapRow>& rows)
+{
+    Block *qblk, *tblk;
+    for (auto& row : rows) {
+        long length = std::min(row.stop[0] - row.start[0] + 1, row.stop[1] - row.start[1] + 1);
+        double score = transform_score(row.score, length);
+        raw_scores.push_back(std::make_pair(row.score, length));
+
+        qblk = genome[0]->add_block(
+            row.seqid[0].ptr, row.seqid[0].len, row.start[0], row.stop[0], score, '+'
+        );
+        tblk = genome[1]->add_block(
+            row.seqid[1].ptr, row.seqid[1].len, row.start[1], row.stop[1], score, row.strand
+        );
+
+        // link homologs
+        LinkedInterval<Block>::link_homologs(qblk, tblk);
+    }
+}
+
+Rcpp::DataFrame Synmap::as_data_frame(size_t gid)
+{
+    return genome[gid]->as_data_frame();
+}
+
+void Synmap::write_cache(std::string cachefile)
+{
+    SynmapCache::write(*this, cachefile);
+}
+
+Rcpp::List Synmap::parameters()
+{
+    return Rcpp::List::create(
+        Rcpp::Named("swap")    = (bool) swap,
+        Rcpp::Named("trans")   = std::string(1, trans),
+        Rcpp::Named("k")       = (int) k,
+        Rcpp::Named("r")       = r,
+        Rcpp::Named("offsets") = std::vector<int>(offsets.begin(), offsets.begin() + 2)
+    );
+}
 
-    genome[0]->set_contig_corners();
-    genome[1]->set_contig_corners();
+void Synmap::link_blocks()
+{
+    genome[0]->link_block_corners(threads);
+    genome[1]->link_block_corners(threads);
+
+    genome[0]->set_contig_corners(threads);
+    genome[1]->set_contig_corners(threads);
 
     long offset = 0;
-    genome[0]->set_overlap_group(offset);
-    genome[1]->set_overlap_group(offset);
+    genome[0]->set_overlap_group(offset, threads);
+    genome[1]->set_overlap_group(offset, threads);
+
+    genome[0]->merge_overlaps(threads, &merges);
+    genome[0]->refresh(threads);
+    genome[1]->refresh(threads);
+
+    Genome::compact_blocks(genome[0], genome[1]);
 
-    genome[0]->merge_overlaps();
-    genome[0]->refresh();
-    genome[1]->refresh();
+    genome[0]->link_adjacent_blocks(threads);
+    genome[1]->link_adjacent_blocks(threads);
 
-    genome[0]->link_adjacent_blocks();
-    genome[1]->link_adjacent_blocks();
+    link_contiguous_sets();
+}
+
+void Synmap::link_contiguous_sets()
+{
+    ConflictIndex conflicts(genome[0], genome[1]);
 
     size_t setid = 0;
-    genome[0]->link_contiguous_blocks(k, setid);
+    genome[0]->link_contiguous_blocks(k, setid, conflicts, threads);
     genome[0]->transfer_contiguous_sets(genome[1]);
 }
 
@@ -157,90 +380,129 @@ Contig* Synmap::get_contig(size_t gid, const char* contig_name)
 
 void Synmap::validate()
 {
-    genome[0]->validate();
-    genome[1]->validate();
+    genome[0]->validate(threads);
+    genome[1]->validate(threads);
 }
 
-
-std::string listToString(std::set<std::string> items, const char* delim){
-    std::stringstream itemStr;
-    std::copy(
-        items.begin(),
-        items.end(),
-        std::ostream_iterator<std::string>(itemStr, delim)
-    );
-    return itemStr.str();
-}
-
-void missingContigWarning(std::set<std::string> missing, int ntotal){
-    if(missing.size() > 0){
-        Rcpp::warning(
-            std::to_string(missing.size())                                    +
-            " out of "                                                        +
-            std::to_string(ntotal + missing.size())                           +
-            " contigs in the query GFF are missing in the synteny map. "      +
-            "It is not unusual for some contigs (scaffolds) to be missing.\n" +
-            "Missing items: [" + listToString(missing, ", ") + "]\n"
-        );
+void Synmap::rescore_blocks()
+{
+    // block ids count from 1, merged blocks keep the id of the block they
+    // were merged into
+    std::vector<double> score(raw_scores.size() + 1, 0);
+    for (size_t i = 0; i < raw_scores.size(); i++) {
+        score[i + 1] = transform_score(raw_scores[i].first, raw_scores[i].second);
+    }
+    for (auto &m : merges) {
+        score[m.b] = Block::merge_score(score[m.a], score[m.b], m.al, m.bl, m.olen);
     }
+    genome[0]->set_scores(score, threads);
 }
 
-void dieOnfailingLines(std::vector<std::string> lines){
-    if(lines.size() > 0){
+void Synmap::reconfigure(long t_k, double t_r, char t_trans)
+{
+    check_trans(t_trans);
 
-        std::vector<std::string>::const_iterator begin = lines.begin();
-        std::vector<std::string>::const_iterator end
-            = lines.size() > 10
-            ? lines.begin() + 10
-            : lines.end();
+    bool rescore = t_trans != trans;
+    bool rechain = t_k != k;
 
-        std::string introStr 
-            = lines.size() > 10
-            ? "First 10 failing lines:\n"
-            : "Failing lines:\n";
+    k     = t_k;
+    r     = t_r;
+    trans = t_trans;
 
-        std::stringstream itemStr;
-        std::copy(begin, end, std::ostream_iterator<std::string>(itemStr, "\n"));
+    if (rescore) {
+        rescore_blocks();
+    }
 
-        Rcpp::stop(
-            "Failed to parse ",
-            std::to_string(lines.size()),
-            "lines. ", introStr,
-            itemStr.str()
-        );
+    if (rechain) {
+        genome[0]->clear_contiguous_sets(threads);
+        genome[1]->clear_contiguous_sets(threads);
+        link_contiguous_sets();
+        validate();
+        // the sets are searched through trees built on the first query
+        frozen[0] = frozen[1] = false;
+    }
+
+    if (rescore || rechain) {
+        block_table.build(genome[0], genome[1], r);
+    } else if (r != block_table.score_r) {
+        block_table.build_scores(r);
     }
 }
 
-Rcpp::CharacterVector Synmap::filter(std::string intfile)
+void Synmap::freeze(size_t gid)
 {
+    if (!frozen[gid]) {
+        genome[gid]->freeze(threads);
+        frozen[gid] = true;
+    }
+}
 
-    std::ifstream fh(intfile);
 
-    if(! fh){
+Rcpp::CharacterVector Synmap::filter(std::string intfile, size_t gid)
+{
+
+    if(! LineReader::readable(intfile)){
         Rcpp::stop("Failed to open filter file\n");
     }
 
-    std::string qseqid, tseqid;
+    LineReader fh(intfile);
+
+    Field qseqid, tseqid;
     long qstart, qstop, tstart, tstop;
 
     Rcpp::CharacterVector out;
 
     std::set<std::string> missingContigs;
-    std::set<std::string> presentContigs;
+    std::set<size_t> presentContigs;
     std::vector<std::string> failingLines;
 
-    std::string line;
-    while (std::getline(fh, line)) {
+    // Lines are read in batches, then checked on up to `threads` threads
+    const size_t BATCH_SIZE = 1 << 16;
+    struct Link { Feature qfeat; Feature tfeat; std::string line; };
+    std::vector<Link> batch;
+    std::vector<char> keep;
+
+    freeze(gid);
+
+    auto check_batch = [&]() {
+        keep.assign(batch.size(), false);
+        size_t nchunks = (batch.size() + QUERY_CHUNK - 1) / QUERY_CHUNK;
+        parallel_for(nchunks, threads, [&](size_t c) {
+            QueryScratch scratch;
+            size_t last = std::min(batch.size(), (c + 1) * QUERY_CHUNK);
+            for (size_t i = c * QUERY_CHUNK; i < last; i++) {
+                Contig* qcon = genome[gid]->get_contig(batch[i].qfeat.parent_id);
+                qcon->list_search_intervals(batch[i].qfeat, r, block_table, scratch);
+                for(auto &s : scratch.si) {
+                    if(s.feature_overlap(&batch[i].tfeat)) {
+                        keep[i] = true;
+                        break;
+                    }
+                }
+            }
+        });
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (keep[i]) {
+                out.push_back(batch[i].line);
+            }
+        }
+        batch.clear();
+    };
+
+    // Input is usually sorted by contig, so only look up a contig (and
+    // record it for the warnings) when the name changes
+    Field last_qseqid;
+    Contig* qcon = nullptr;
+
+    while (fh.next_line()) {
 
         // skip comments
-        if (line[0] == '#')
+        if (fh.is_comment())
             continue;
 
-        std::stringstream row(line);
-
         if (
-            row >> qseqid >> qstart >> qstop
-                >> tseqid >> tstart >> tstop
+            fh.read(qseqid) && fh.read(qstart) && fh.read(qstop) &&
+            fh.read(tseqid) && fh.read(tstart) && fh.read(tstop)
         ) {
 
             qstart -= offsets[0];
@@ -248,30 +510,34 @@ Rcpp::CharacterVector Synmap::filter(std::string intfile)
             qstop  -= offsets[1];
             tstop  -= offsets[1];
 
-            Feature qfeat(qseqid.c_str(), qstart, qstop);
-            Feature tfeat(tseqid.c_str(), tstart, tstop);
-
-            Contig* qcon = get_contig(0, qseqid.c_str());
-            if(qcon == nullptr) {
-                missingContigs.insert(std::string(qseqid));
-            } else {
-                // FIXME: trades performance for more informative warnings 
-                presentContigs.insert(std::string(qseqid));
+            if(last_qseqid.ptr == nullptr || qseqid != last_qseqid) {
+                qcon = genome[gid]->get_contig(names.find(qseqid.ptr, qseqid.len));
+                last_qseqid = qseqid;
+                if(qcon == nullptr) {
+                    missingContigs.insert(qseqid.str());
+                } else {
+                    presentContigs.insert(qcon->feat.name_id);
+                }
+            }
 
-                std::vector<SearchInterval> si = qcon->list_search_intervals(qfeat, r);
-                for(auto &s : si) {
-                    if(s.feature_overlap(&tfeat)) {
-                        out.push_back(line);
-                        break;
-                    }
+            if(qcon != nullptr) {
+                batch.push_back({
+                    Feature(qcon->feat.name_id, qstart, qstop),
+                    Feature(names.find(tseqid.ptr, tseqid.len), tstart, tstop),
+                    fh.line()
+                });
+                if (batch.size() == BATCH_SIZE) {
+                    check_batch();
                 }
             }
 
         } else {
-            failingLines.push_back(line);
+            failingLines.push_back(fh.line());
         }
     }
 
+    check_batch();
+
     dieOnfailingLines(failingLines);
     missingContigWarning(missingContigs, presentContigs.size());
 
@@ -279,122 +545,217 @@ Rcpp::CharacterVector Synmap::filter(std::string intfile)
 }
 
 
-std::vector<Feature> Synmap::gff2features(std::string gfffile)
+std::vector<Feature> Synmap::gff2features(std::string gfffile, size_t gid)
 {
 
-    std::ifstream fh(gfffile);
-
-    if(! fh){
+    if(! LineReader::readable(gfffile)){
         Rcpp::stop("Failed to open GFF file\n");
     }
 
-    // start and stop positions read from input line
-    long start, stop;
-    // Name of query input (e.g. AT1G01010)
-    std::string seqname;
-    // Index of query chromosome
-    std::string contig_seqname;
-    // query contig
-    Contig* qcon;
+    LineReader fh(gfffile);
 
-    std::vector<Feature> feats;
+    std::vector<FeatureRow> rows;
 
-    std::set<std::string> missingContigs;
-    std::set<std::string> presentContigs;
     std::vector<std::string> failingLines;
 
-    std::string line;
-    while (std::getline(fh, line)) {
+    read_feature_rows(fh, std::numeric_limits<size_t>::max(), rows, failingLines);
 
-        // skip comments
-        if (line[0] == '#')
-            continue;
+    dieOnfailingLines(failingLines);
+
+    // the rows point into fh, so they are resolved while it is open
+    return rows2features(rows, gid);
+}
 
-        std::stringstream row(line);
+void Synmap::read_feature_rows(
+    LineReader& fh,
+    size_t max_rows,
+    std::vector<FeatureRow>& rows,
+    std::vector<std::string>& failingLines
+)
+{
+    FeatureRow row;
+    // unused GFF columns
+    Field skip;
+
+    while (rows.size() < max_rows && fh.next_line()) {
 
-        std::string r2, r3, r6, r7, r8;
+        // skip comments
+        if (fh.is_comment())
+            continue;
 
         if (
-            row >> contig_seqname >> r2 >> r3
-                >> start >> stop
-                >> r6 >> r7 >> r8
-                >> seqname
+            fh.read(row.seqid) && fh.read(skip) && fh.read(skip) &&
+            fh.read(row.start) && fh.read(row.stop) &&
+            fh.read(skip) && fh.read(skip) && fh.read(skip) &&
+            fh.read(row.name)
         ){
-            // check_in_offset(start, stop);
-            start -= offsets[2];
-            stop  -= offsets[3];
-            qcon = get_contig(0, contig_seqname.c_str());
-            if(qcon == nullptr) {
-                missingContigs.insert(std::string(contig_seqname));
-            } else {
-                // FIXME: trades performance for better warnings
-                presentContigs.insert(std::string(contig_seqname));
-
-                Feature feat(contig_seqname.c_str(), start, stop, seqname.c_str(), 0);
-                feats.push_back(feat);
-            }
+            rows.push_back(row);
         } else {
-            failingLines.push_back(line);
+            failingLines.push_back(fh.line());
         }
     }
+}
+
+std::vector<Feature> Synmap::rows2features(const std::vector<FeatureRow>& rows, size_t gid)
+{
+    std::set<std::string> missingContigs;
+    std::set<size_t> presentContigs;
+
+    std::vector<Feature> feats = rows2features(rows, gid, missingContigs, presentContigs);
 
-    dieOnfailingLines(failingLines);
     missingContigWarning(missingContigs, presentContigs.size());
 
     return feats;
 }
 
-Rcpp::DataFrame Synmap::count(std::string intfile)
+std::vector<Feature> Synmap::rows2features(
+    const std::vector<FeatureRow>& rows,
+    size_t gid,
+    std::set<std::string>& missingContigs,
+    std::set<size_t>& presentContigs
+)
 {
+    std::vector<Feature> feats;
+    feats.reserve(rows.size());
 
-    std::vector<Feature> feats = gff2features(intfile);
+    // GFFs are sorted by contig, so only look up a contig (and record it for
+    // the warnings) when the name changes
+    Field last_seqid;
+    Contig* qcon = nullptr;
 
-    CountType out;
+    std::string name;
+    for (auto &row : rows) {
 
-    for(auto &feat : feats) {
-
-        Contig* qcon = get_contig(0, feat.parent_name.c_str());
+        if(last_seqid.ptr == nullptr || row.seqid != last_seqid) {
+            qcon = genome[gid]->get_contig(names.find(row.seqid.ptr, row.seqid.len));
+            last_seqid = row.seqid;
+            if(qcon == nullptr) {
+                missingContigs.insert(row.seqid.str());
+            } else {
+                presentContigs.insert(qcon->feat.name_id);
+            }
+        }
 
-        qcon->count(feat, out);
+        if(qcon != nullptr) {
+            // check_in_offset(start, stop);
+            name.assign(row.name.ptr, row.name.len);
+            feats.push_back(Feature(
+                qcon->feat.name_id,
+                row.start - offsets[2],
+                row.stop  - offsets[3],
+                name.c_str(),
+                0
+            ));
+        }
     }
 
-    return out.as_data_frame();
-
+    return feats;
 }
 
-Rcpp::DataFrame Synmap::map(std::string intfile)
+Rcpp::DataFrame Synmap::count(std::string intfile, size_t gid)
 {
+    return count_features(gff2features(intfile, gid), gid);
+}
 
-    std::vector<Feature> feats = gff2features(intfile);
-
-    MapType out;
-
-    for(auto &feat : feats) {
+Rcpp::DataFrame Synmap::map(std::string intfile, size_t gid)
+{
+    return map_features(gff2features(intfile, gid), gid);
+}
 
-        Contig* qcon = get_contig(0, feat.parent_name.c_str());
+Rcpp::DataFrame Synmap::search(std::string intfile, size_t gid)
+{
+    return search_features(gff2features(intfile, gid), gid);
+}
 
-        qcon->map(feat, out);
-    }
+Rcpp::DataFrame Synmap::count(const std::vector<FeatureRow>& rows, size_t gid)
+{
+    return count_features(rows2features(rows, gid), gid);
+}
 
-    return out.as_data_frame();
+Rcpp::DataFrame Synmap::map(const std::vector<FeatureRow>& rows, size_t gid)
+{
+    return map_features(rows2features(rows, gid), gid);
+}
 
+Rcpp::DataFrame Synmap::search(const std::vector<FeatureRow>& rows, size_t gid)
+{
+    return search_features(rows2features(rows, gid), gid);
 }
 
-Rcpp::DataFrame Synmap::search(std::string intfile)
+template <class F>
+void Synmap::run_features(std::vector<Feature>& feats, size_t gid, ResultSink& out, F query)
 {
+    // Features within a chunk share a scratch, so sorted input is still
+    // swept (see IntervalSet::sweep_region). The chunks are the same however
+    // many threads there are, so the results are too.
 
-    std::vector<Feature> feats = gff2features(intfile);
+    freeze(gid);
 
-    SIType out;
+    size_t nchunks = (feats.size() + QUERY_CHUNK - 1) / QUERY_CHUNK;
 
-    for(auto &feat : feats) {
+    auto run_chunk = [&](size_t c, ResultSink& rows) {
+        QueryScratch scratch;
+        size_t last = std::min(feats.size(), (c + 1) * QUERY_CHUNK);
+        for (size_t i = c * QUERY_CHUNK; i < last; i++) {
+            query(genome[gid]->get_contig(feats[i].parent_id), feats[i], scratch, rows);
+        }
+    };
 
-        Contig* qcon = get_contig(0, feat.parent_name.c_str());
+    if (threads <= 1 || nchunks <= 1) {
+        for (size_t c = 0; c < nchunks; c++) {
+            run_chunk(c, out);
+        }
+        return;
+    }
 
-        // modifies out
-        qcon->find_search_intervals(feat, r, out);
+    std::vector<ResultBuffer> buffers(nchunks);
+    parallel_for(nchunks, threads, [&](size_t c) {
+        run_chunk(c, buffers[c]);
+    });
+
+    for (auto &buffer : buffers) {
+        buffer.replay(out);
     }
+}
 
+void Synmap::count_features(std::vector<Feature>& feats, size_t gid, ResultSink& out)
+{
+    run_features(feats, gid, out, [&](Contig* con, Feature& feat, QueryScratch&, ResultSink& rows) {
+        con->count(feat, rows);
+    });
+}
+
+void Synmap::map_features(std::vector<Feature>& feats, size_t gid, ResultSink& out)
+{
+    run_features(feats, gid, out, [&](Contig* con, Feature& feat, QueryScratch& scratch, ResultSink& rows) {
+        con->map(feat, scratch, rows);
+    });
+}
+
+void Synmap::search_features(std::vector<Feature>& feats, size_t gid, ResultSink& out)
+{
+    run_features(feats, gid, out, [&](Contig* con, Feature& feat, QueryScratch& scratch, ResultSink& rows) {
+        con->find_search_intervals(feat, r, block_table, scratch, rows);
+    });
+}
+
+Rcpp::DataFrame Synmap::count_features(std::vector<Feature> feats, size_t gid)
+{
+    CountType out;
+    count_features(feats, gid, out);
     return out.as_data_frame();
+}
 
+Rcpp::DataFrame Synmap::map_features(std::vector<Feature> feats, size_t gid)
+{
+    MapType out;
+    map_features(feats, gid, out);
+    return out.as_data_frame(names);
+}
+
+Rcpp::DataFrame Synmap::search_features(std::vector<Feature> feats, size_t gid)
+{
+    SIType out;
+    search_features(feats, gid, out);
+    return out.as_data_frame(names);
 }
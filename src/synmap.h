@@ -7,6 +7,9 @@
 #include "linked_interval.h"
 #include "feature.h"
 #include "types.h"
+#include "synmap_cache.h"
+#include "block_table.h"
+#include "line_reader.h"
 
 #include <iostream>
 #include <sstream>
@@ -14,12 +17,48 @@
 #include <iterator>
 #include <list>
 #include <array>
+#include <set>
+#include <limits>
+#include <thread>
+#include <exception>
 #include <Rcpp.h>
 
 
+/** One line of a synteny map, fields point into the mapped file (or R strings) */
+struct SynmapRow
+{
+    Field  seqid[2];
+    long   start[2];
+    long   stop[2];
+    double score;
+    char   strand;
+};
+
+/** One line of a GFF, fields point into the mapped file (or R strings) */
+struct FeatureRow
+{
+    Field seqid;
+    long  start;
+    long  stop;
+    Field name;
+};
+
+/** The rows (and unparseable lines) of one chunk of a synteny map file */
+struct SynmapChunk
+{
+    std::vector<SynmapRow>   rows;
+    std::vector<std::string> failing;
+};
+
+// Reporting helpers shared by all readers of input files (see synmap.cpp)
+void missingContigWarning(std::set<std::string> missing, int ntotal);
+void dieOnfailingLines(std::vector<std::string> lines);
+
 /** A pair of syntenically linked Genome objects  */
 class Synmap
 {
+friend class SynmapCache;
+friend class QueryCursor;
 private:
     Genome* genome[2] = { nullptr, nullptr };
     std::string synfile;
@@ -29,24 +68,116 @@ private:
     long    k         = 0;
     double  r         = 0.001;
     char    trans     = 'i';
+    size_t  threads   = 1;
+    // whether the query structures of each genome are built
+    bool    frozen[2] = { false, false };
 
     // The {{ is needed to workaround a bug in old g++ compilers
     std::array<int,4> offsets = {{1,1,1,1}};
 
+    // contig names of both genomes
+    NameTable names;
+
+    // frozen copy of the linked blocks, read by searches
+    BlockTable block_table;
+
+    // score and length of each row as read, by block id - 1, and the merges
+    // of the blocks, so the scores can be transformed anew (see rescore_blocks)
+    std::vector<std::pair<double, long>> raw_scores;
+    std::vector<ScoreMerge> merges;
+
     // utility function for loading GFF files
-    std::vector<Feature> gff2features(std::string fh);
+    std::vector<Feature> gff2features(std::string fh, size_t gid);
+
+    // read up to max_rows GFF rows, unparseable lines go to failingLines
+    void read_feature_rows(
+        LineReader& fh,
+        size_t max_rows,
+        std::vector<FeatureRow>& rows,
+        std::vector<std::string>& failingLines
+    );
+
+    // apply GFF offsets and drop (with a warning) features on contigs
+    // unknown to genome gid
+    std::vector<Feature> rows2features(const std::vector<FeatureRow>& rows, size_t gid);
+
+    // as above, but collect the contigs for the warning across many calls
+    std::vector<Feature> rows2features(
+        const std::vector<FeatureRow>& rows,
+        size_t gid,
+        std::set<std::string>& missingContigs,
+        std::set<size_t>& presentContigs
+    );
+
+    /** Run query(con, feat, scratch, out) for each feature on up to `threads` threads
+     *
+     * con is the feature's contig in genome gid. Features are handed out in
+     * fixed size chunks, each with its own scratch and ResultBuffer, and the
+     * buffers are passed on to out in input order. query must not call the R
+     * API.
+     */
+    template <class F>
+    void run_features(std::vector<Feature>& feats, size_t gid, ResultSink& out, F query);
+
+    // run the query for each feature of genome gid, the rows go to out
+    void count_features(std::vector<Feature>& feats, size_t gid, ResultSink& out);
+
+    void map_features(std::vector<Feature>& feats, size_t gid, ResultSink& out);
+
+    void search_features(std::vector<Feature>& feats, size_t gid, ResultSink& out);
+
+    // as above, collecting the rows in a data.frame
+    Rcpp::DataFrame count_features(std::vector<Feature> feats, size_t gid);
+
+    Rcpp::DataFrame map_features(std::vector<Feature> feats, size_t gid);
+
+    Rcpp::DataFrame search_features(std::vector<Feature> feats, size_t gid);
 
     void build_synmap();
 
     // loads synfile and calls the below functions in proper order
     void load_blocks();
 
+    // parse one line of the synteny map and apply the offsets (thread safe)
+    bool parse_block_row(LineReader& fh, SynmapRow& row) const;
+
+    // apply offsets to a row
+    void offset_row(SynmapRow& row) const;
+
+    // apply the score transform to the score of a row of the given length
+    double transform_score(double score, long length) const;
+
+    // whether trans is a known score transform
+    static bool is_trans(char trans);
+
+    // die on an unknown score transform
+    static void check_trans(char trans);
+
+    // add and link a pair of blocks for each row, transforming the scores
+    void add_blocks(const std::vector<SynmapRow>& rows);
+
+    // parse all lines in [begin, end) (thread safe)
+    void parse_block_chunk(const char* begin, const char* end, SynmapChunk& chunk) const;
+
     // wrappers for Genome functions
     void link_blocks();
 
+    // chain the blocks into contiguous sets, given k
+    void link_contiguous_sets();
+
+    // transform the raw scores and replay the merges, given trans
+    void rescore_blocks();
+
     /** Checks invariants - dies if anything goes wrong */
     void validate();
 
+    /** Build the query structures of genome gid, if not yet built
+     *
+     * Called on the calling thread before the first query from gid is run,
+     * queries only read the map from then on.
+     */
+    void freeze(size_t gid);
+
 public:
     Synmap(
         std::string  synfile,
@@ -56,22 +187,72 @@ public:
         int    k,
         double r,
         char   trans,
-        std::vector<int> offsets
+        std::vector<int> offsets,
+        size_t threads = 1
     );
 
+    /** Build a synteny map from rows held in memory
+     *
+     * Rows are in synteny map file order (query first, unless swap is set)
+     * and are offset and transformed exactly as lines of a file would be.
+     */
+    Synmap(
+        const std::vector<SynmapRow>& rows,
+        const ContigLengths& tcl,
+        const ContigLengths& qcl,
+        bool   swap,
+        int    k,
+        double r,
+        char   trans,
+        std::vector<int> offsets,
+        size_t threads = 1
+    );
+
+    /** Load a prebuilt synteny map from a cache written by write_cache */
+    Synmap(std::string cachefile, size_t threads = 1);
+
     ~Synmap();
 
+    /** Save the linked synteny map as a binary cache (see SynmapCache) */
+    void write_cache(std::string cachefile);
+
+    /** Get the parameters the synteny map was built with */
+    Rcpp::List parameters();
+
+    /** Change k, r and the score transform of a linked synteny map
+     *
+     * Only the stages a parameter affects are redone: a new k rechains the
+     * contiguous sets and a new trans rescores the blocks from the scores
+     * as read. r is only used by searches. The map is then as if it had been built with the new
+     * parameters.
+     */
+    void reconfigure(long k, double r, char trans);
+
     Contig* get_contig(size_t gid, const char* contig_name);
 
-    Rcpp::DataFrame as_data_frame();
+    /** Contig names of both genomes, indexed by contig id */
+    const NameTable& contig_names() const { return names; }
+
+    // Queries run from genome gid to the other genome. Both genomes keep
+    // their blocks and contiguous sets, so gid 1 answers the reverse of the
+    // queries the map was built for (as if loaded with swap) without a rebuild.
+
+    Rcpp::DataFrame as_data_frame(size_t gid = 0);
+
+    Rcpp::DataFrame count(std::string intfile, size_t gid = 0);
+
+    Rcpp::DataFrame map(std::string intfile, size_t gid = 0);
+
+    Rcpp::DataFrame search(std::string intfile, size_t gid = 0);
 
-    Rcpp::DataFrame count(std::string intfile);
+    // As above, but for GFF rows already in memory
+    Rcpp::DataFrame count(const std::vector<FeatureRow>& rows, size_t gid = 0);
 
-    Rcpp::DataFrame map(std::string intfile);
+    Rcpp::DataFrame map(const std::vector<FeatureRow>& rows, size_t gid = 0);
 
-    Rcpp::DataFrame search(std::string intfile);
+    Rcpp::DataFrame search(const std::vector<FeatureRow>& rows, size_t gid = 0);
 
-    Rcpp::CharacterVector filter(std::string hitfile);
+    Rcpp::CharacterVector filter(std::string hitfile, size_t gid = 0);
 
 };
 
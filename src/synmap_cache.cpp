@@ -0,0 +1,377 @@
+#include "synmap_cache.h"
+#include "synmap.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <Rcpp.h>
+
+static const char CACHE_MAGIC[8] = { 'S', 'Y', 'N', 'D', 'E', 'R', 'C', 'A' };
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+// Every section must keep the following one 8-byte aligned
+static_assert(sizeof(SynmapCache::CacheHeader) % 8 == 0, "CacheHeader is not 8-byte aligned");
+static_assert(sizeof(SynmapCache::CacheContig) % 8 == 0, "CacheContig is not 8-byte aligned");
+static_assert(sizeof(SynmapCache::CacheBlock)  % 8 == 0, "CacheBlock is not 8-byte aligned");
+static_assert(sizeof(SynmapCache::CacheCset)   % 8 == 0, "CacheCset is not 8-byte aligned");
+static_assert(sizeof(SynmapCache::CacheScore)  % 8 == 0, "CacheScore is not 8-byte aligned");
+static_assert(sizeof(SynmapCache::CacheMerge)  % 8 == 0, "CacheMerge is not 8-byte aligned");
+
+template <class T>
+static uint32_t index_of(const std::unordered_map<T*, uint32_t>& idx, T* x)
+{
+    if (x == nullptr) {
+        return SynmapCache::NIL;
+    }
+    auto it = idx.find(x);
+    if (it == idx.end()) {
+        Rcpp::stop("Synmap link points outside the map, cannot write cache\n");
+    }
+    return it->second;
+}
+
+template <class T>
+static T* pointer_at(const std::vector<T*>& v, uint32_t i)
+{
+    if (i == SynmapCache::NIL) {
+        return nullptr;
+    }
+    if (i >= v.size()) {
+        Rcpp::stop("Corrupt synder cache: link index out of range\n");
+    }
+    return v[i];
+}
+
+// Point x at the n elements of T at offset and move offset past them. n comes
+// from the file, so it is checked against the bytes left before it is
+// multiplied out. false if the section would run past the end of the file.
+template <class T>
+static bool section_at(const char* base, size_t size, size_t& offset, uint64_t n, const T*& x)
+{
+    if (n > (size - offset) / sizeof(T)) {
+        return false;
+    }
+    x = reinterpret_cast<const T*>(base + offset);
+    offset += n * sizeof(T);
+    return true;
+}
+
+template <class T>
+static void write_array(std::ofstream& fh, const std::vector<T>& v)
+{
+    if (!v.empty()) {
+        fh.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+    }
+}
+
+void SynmapCache::write(Synmap& synmap, const std::string& filename)
+{
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version    = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.k          = synmap.k;
+    header.r          = synmap.r;
+    header.swap       = synmap.swap;
+    header.trans      = synmap.trans;
+    for (size_t i = 0; i < 4; i++) {
+        header.offsets[i] = synmap.offsets[i];
+    }
+
+    std::unordered_map<Block*, uint32_t>         block_idx[2];
+    std::unordered_map<ContiguousSet*, uint32_t> cset_idx[2];
+
+    // Number every live block and set. Blocks killed while merging overlaps
+    // are no longer in any contig's block list, so they are dropped here.
+    for (size_t g = 0; g < 2; g++) {
+        for (auto &pair : synmap.genome[g]->contig) {
+            Contig* con = pair.second;
+            for (auto &blk : con->block.inv) {
+                uint32_t i = block_idx[g].size();
+                block_idx[g][blk] = i;
+            }
+            for (auto &cset : con->cset.inv) {
+                uint32_t i = cset_idx[g].size();
+                cset_idx[g][cset] = i;
+            }
+        }
+    }
+
+    std::vector<CacheContig> contigs[2];
+    std::vector<CacheBlock>  blocks[2];
+    std::vector<CacheCset>   csets[2];
+    std::string names;
+
+    for (size_t g = 0; g < 2; g++) {
+        size_t h = !g;
+        for (auto &pair : synmap.genome[g]->contig) {
+            Contig* con = pair.second;
+
+            CacheContig c;
+            std::memset(&c, 0, sizeof(c));
+            c.name        = names.size();
+            c.name_length = pair.first.size();
+            c.length      = con->feat.parent_length;
+            for (size_t i = 0; i < 4; i++) {
+                c.cor[i] = index_of(block_idx[g], con->block.corner(i));
+            }
+            c.first_block = blocks[g].size();
+            c.nblocks     = con->block.inv.size();
+            c.first_cset  = csets[g].size();
+            c.ncsets      = con->cset.inv.size();
+            names += pair.first;
+
+            uint32_t contig_index = contigs[g].size();
+            contigs[g].push_back(c);
+
+            for (auto &blk : con->block.inv) {
+                CacheBlock b;
+                std::memset(&b, 0, sizeof(b));
+                b.pos[0] = blk->pos[0];
+                b.pos[1] = blk->pos[1];
+                b.score  = blk->score;
+                b.grpid  = blk->grpid;
+                b.id     = blk->id;
+                b.contig = contig_index;
+                b.over   = index_of(block_idx[h], blk->over);
+                for (size_t i = 0; i < 4; i++) {
+                    b.cor[i] = index_of(block_idx[g], blk->cor[i]);
+                }
+                for (size_t i = 0; i < 2; i++) {
+                    b.adj[i] = index_of(block_idx[g], blk->adj[i]);
+                    b.cnr[i] = index_of(block_idx[g], blk->cnr[i]);
+                }
+                b.cset   = index_of(cset_idx[g], blk->cset);
+                b.strand = blk->strand;
+                blocks[g].push_back(b);
+            }
+
+            for (auto &cset : con->cset.inv) {
+                CacheCset s;
+                std::memset(&s, 0, sizeof(s));
+                s.pos[0]  = cset->pos[0];
+                s.pos[1]  = cset->pos[1];
+                s.score   = cset->score;
+                s.id      = cset->id;
+                s.size    = cset->size;
+                s.contig  = contig_index;
+                s.over    = index_of(cset_idx[h], cset->over);
+                s.ends[0] = index_of(block_idx[g], cset->ends[0]);
+                s.ends[1] = index_of(block_idx[g], cset->ends[1]);
+                s.strand  = cset->strand;
+                csets[g].push_back(s);
+            }
+        }
+        header.ncontig[g] = contigs[g].size();
+        header.nblock[g]  = blocks[g].size();
+        header.ncset[g]   = csets[g].size();
+    }
+    header.nchar = names.size();
+
+    std::vector<CacheScore> scores;
+    scores.reserve(synmap.raw_scores.size());
+    for (auto &raw : synmap.raw_scores) {
+        scores.push_back({ raw.first, raw.second });
+    }
+    header.nscore = scores.size();
+
+    std::vector<CacheMerge> merges;
+    merges.reserve(synmap.merges.size());
+    for (auto &m : synmap.merges) {
+        merges.push_back({ m.a, m.b, m.al, m.bl, m.olen });
+    }
+    header.nmerge = merges.size();
+
+    std::ofstream fh(filename, std::ios::binary | std::ios::trunc);
+    if (!fh) {
+        Rcpp::stop("Failed to open cache file '" + filename + "' for writing\n");
+    }
+
+    fh.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(fh, contigs[0]);
+    write_array(fh, contigs[1]);
+    write_array(fh, blocks[0]);
+    write_array(fh, blocks[1]);
+    write_array(fh, csets[0]);
+    write_array(fh, csets[1]);
+    write_array(fh, scores);
+    write_array(fh, merges);
+    fh.write(names.data(), names.size());
+
+    if (!fh) {
+        Rcpp::stop("Failed to write cache file '" + filename + "'\n");
+    }
+}
+
+void SynmapCache::read(Synmap& synmap, const std::string& filename)
+{
+    MappedFile fh(filename);
+
+    if (fh.size() < sizeof(CacheHeader)) {
+        Rcpp::stop("'" + filename + "' is not a synder cache\n");
+    }
+
+    const char* base = fh.data();
+    const CacheHeader* header = reinterpret_cast<const CacheHeader*>(base);
+
+    if (std::memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        Rcpp::stop("'" + filename + "' is not a synder cache\n");
+    }
+    if (header->byte_order != BYTE_ORDER_MARK) {
+        Rcpp::stop("Synder cache '" + filename + "' was written on a machine with a different byte order\n");
+    }
+    if (header->version != VERSION) {
+        Rcpp::stop("Synder cache '" + filename + "' has an unsupported version, please write it again\n");
+    }
+
+    if (!Synmap::is_trans(header->trans)) {
+        Rcpp::stop("Corrupt synder cache '" + filename + "': unknown score transform\n");
+    }
+
+    // Locate the sections, everything is stored back to back
+    size_t offset = sizeof(CacheHeader);
+    const CacheContig* contigs[2];
+    const CacheBlock*  blocks[2];
+    const CacheCset*   csets[2];
+    const CacheScore*  scores;
+    const CacheMerge*  merges;
+    bool fits = true;
+    for (size_t g = 0; g < 2; g++) {
+        fits = fits && section_at(base, fh.size(), offset, header->ncontig[g], contigs[g]);
+    }
+    for (size_t g = 0; g < 2; g++) {
+        fits = fits && section_at(base, fh.size(), offset, header->nblock[g], blocks[g]);
+    }
+    for (size_t g = 0; g < 2; g++) {
+        fits = fits && section_at(base, fh.size(), offset, header->ncset[g], csets[g]);
+    }
+    fits = fits && section_at(base, fh.size(), offset, header->nscore, scores);
+    fits = fits && section_at(base, fh.size(), offset, header->nmerge, merges);
+    const char* names = base + offset;
+
+    if (!fits || header->nchar != fh.size() - offset) {
+        Rcpp::stop("Corrupt synder cache '" + filename + "': unexpected file size\n");
+    }
+
+    synmap.k     = header->k;
+    synmap.r     = header->r;
+    synmap.swap  = header->swap;
+    synmap.trans = header->trans;
+    for (size_t i = 0; i < 4; i++) {
+        synmap.offsets[i] = header->offsets[i];
+    }
+
+    synmap.genome[0] = new Genome("Q", &synmap.names);
+    synmap.genome[1] = new Genome("T", &synmap.names);
+
+    std::vector<Contig*>        contig_ptr[2];
+    std::vector<Block*>         block_ptr[2];
+    std::vector<ContiguousSet*> cset_ptr[2];
+
+    // First allocate every object, then resolve the links between them
+    for (size_t g = 0; g < 2; g++) {
+        Genome* gen = synmap.genome[g];
+
+        for (size_t i = 0; i < header->ncontig[g]; i++) {
+            const CacheContig& c = contigs[g][i];
+            if (c.name > header->nchar || c.name_length > header->nchar - c.name) {
+                Rcpp::stop("Corrupt synder cache: contig name out of range\n");
+            }
+            Contig* con = gen->add_contig(names + c.name, c.name_length);
+            con->set_length(c.length);
+            contig_ptr[g].push_back(con);
+        }
+
+        for (size_t i = 0; i < header->nblock[g]; i++) {
+            const CacheBlock& b = blocks[g][i];
+            Contig* con = pointer_at(contig_ptr[g], b.contig);
+            if (con == nullptr) {
+                Rcpp::stop("Corrupt synder cache: block without contig\n");
+            }
+            Block* blk = gen->pool.make(
+                b.pos[0], b.pos[1], b.score, b.strand, &con->feat, b.id
+            );
+            blk->grpid = b.grpid;
+            block_ptr[g].push_back(blk);
+        }
+
+        for (size_t i = 0; i < header->ncset[g]; i++) {
+            const CacheCset& s = csets[g][i];
+            Contig* con = pointer_at(contig_ptr[g], s.contig);
+            if (con == nullptr) {
+                Rcpp::stop("Corrupt synder cache: contiguous set without contig\n");
+            }
+            ContiguousSet* cset = gen->cset_pool.make();
+            cset->parent = &con->feat;
+            cset->pos[0] = s.pos[0];
+            cset->pos[1] = s.pos[1];
+            cset->score  = s.score;
+            cset->id     = s.id;
+            cset->size   = s.size;
+            cset->strand = s.strand;
+            con->cset.inv.push_back(cset);
+            cset_ptr[g].push_back(cset);
+        }
+    }
+
+    for (size_t g = 0; g < 2; g++) {
+        size_t h = !g;
+
+        for (size_t i = 0; i < header->nblock[g]; i++) {
+            const CacheBlock& b = blocks[g][i];
+            Block* blk = block_ptr[g][i];
+            blk->over = pointer_at(block_ptr[h], b.over);
+            for (size_t j = 0; j < 4; j++) {
+                blk->cor[j] = pointer_at(block_ptr[g], b.cor[j]);
+            }
+            for (size_t j = 0; j < 2; j++) {
+                blk->adj[j] = pointer_at(block_ptr[g], b.adj[j]);
+                blk->cnr[j] = pointer_at(block_ptr[g], b.cnr[j]);
+            }
+            blk->cset = pointer_at(cset_ptr[g], b.cset);
+        }
+
+        for (size_t i = 0; i < header->ncset[g]; i++) {
+            const CacheCset& s = csets[g][i];
+            ContiguousSet* cset = cset_ptr[g][i];
+            cset->over    = pointer_at(cset_ptr[h], s.over);
+            cset->ends[0] = pointer_at(block_ptr[g], s.ends[0]);
+            cset->ends[1] = pointer_at(block_ptr[g], s.ends[1]);
+        }
+
+        for (size_t i = 0; i < header->ncontig[g]; i++) {
+            const CacheContig& c = contigs[g][i];
+            Contig* con = contig_ptr[g][i];
+            if (
+                (size_t) c.first_block + c.nblocks > block_ptr[g].size() ||
+                (size_t) c.first_cset  + c.ncsets  > cset_ptr[g].size()
+            ) {
+                Rcpp::stop("Corrupt synder cache: contig range out of bounds\n");
+            }
+            con->block.inv.assign(
+                block_ptr[g].begin() + c.first_block,
+                block_ptr[g].begin() + c.first_block + c.nblocks
+            );
+            for (size_t j = 0; j < 4; j++) {
+                con->block.set_corner(j, pointer_at(block_ptr[g], c.cor[j]));
+            }
+        }
+    }
+
+    synmap.raw_scores.resize(header->nscore);
+    for (size_t i = 0; i < header->nscore; i++) {
+        synmap.raw_scores[i] = std::make_pair(scores[i].score, (long) scores[i].length);
+    }
+
+    synmap.merges.resize(header->nmerge);
+    for (size_t i = 0; i < header->nmerge; i++) {
+        const CacheMerge& m = merges[i];
+        // block ids count from 1, see Synmap::rescore_blocks
+        if (m.a < 1 || m.a > header->nscore || m.b < 1 || m.b > header->nscore) {
+            Rcpp::stop("Corrupt synder cache: merge of an unknown block\n");
+        }
+        synmap.merges[i] = { (size_t) m.a, (size_t) m.b, m.al, m.bl, m.olen };
+    }
+}
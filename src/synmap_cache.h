@@ -0,0 +1,114 @@
+#ifndef __SYNMAP_CACHE_H__
+#define __SYNMAP_CACHE_H__
+
+#include <stdint.h>
+#include <string>
+
+class Synmap;
+
+/** Position-independent binary image of a fully linked Synmap
+ *
+ * The file holds the contigs, the merged blocks and the contiguous sets of
+ * both genomes, and the scores as read and the merges of the blocks (so the
+ * map can be rescored, see Synmap::rescore_blocks). Every link (homologs,
+ * corners, adjacent blocks, contiguous set neighbors) is stored as an index
+ * into the arrays of the file rather than as a pointer. Reading a cache
+ * replaces parsing, merging and linking the synteny map with a single pass of
+ * index-to-pointer fixups. The map is rebuilt in the memory of the reading
+ * process, the file is not queried in place.
+ *
+ * Layout (all sections 8-byte aligned, native byte order):
+ *   CacheHeader
+ *   CacheContig[ncontig[0]]  CacheContig[ncontig[1]]
+ *   CacheBlock[nblock[0]]    CacheBlock[nblock[1]]
+ *   CacheCset[ncset[0]]      CacheCset[ncset[1]]
+ *   CacheScore[nscore]
+ *   CacheMerge[nmerge]
+ *   char[nchar]              contig names
+ *
+ * Blocks and sets are stored grouped by contig, in the order of the contig's
+ * block and set lists, so each contig refers to them by a range.
+ */
+class SynmapCache
+{
+public:
+    static const uint32_t VERSION = 2;
+    static const uint32_t NIL = 0xFFFFFFFF;
+
+    struct CacheHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        int64_t  k;
+        double   r;
+        int32_t  swap;
+        int32_t  offsets[4];
+        char     trans;
+        char     pad[3];
+        uint64_t ncontig[2];
+        uint64_t nblock[2];
+        uint64_t ncset[2];
+        uint64_t nchar;
+        uint64_t nscore;
+        uint64_t nmerge;
+    };
+
+    struct CacheContig {
+        uint64_t name;        // offset into the name section
+        uint64_t name_length;
+        int64_t  length;
+        uint32_t cor[4];      // first and last blocks by start and stop
+        uint32_t first_block;
+        uint32_t nblocks;
+        uint32_t first_cset;
+        uint32_t ncsets;
+    };
+
+    struct CacheBlock {
+        int64_t  pos[2];
+        double   score;
+        int64_t  grpid;
+        uint64_t id;
+        uint32_t contig;
+        uint32_t over;        // index into the other genome's blocks
+        uint32_t cor[4];
+        uint32_t adj[2];
+        uint32_t cnr[2];
+        uint32_t cset;
+        char     strand;
+        char     pad[3];
+    };
+
+    struct CacheCset {
+        int64_t  pos[2];
+        double   score;
+        uint64_t id;
+        uint64_t size;
+        uint32_t contig;
+        uint32_t over;        // index into the other genome's sets
+        uint32_t ends[2];
+        char     strand;
+        char     pad[7];
+    };
+
+    struct CacheScore {
+        double   score;       // as read, by block id - 1
+        int64_t  length;
+    };
+
+    struct CacheMerge {
+        uint64_t a;
+        uint64_t b;
+        double   al;
+        double   bl;
+        double   olen;
+    };
+
+    /** Write a linked (and validated) Synmap to a cache file */
+    static void write(Synmap& synmap, const std::string& filename);
+
+    /** Rebuild a Synmap from a cache file written by SynmapCache::write */
+    static void read(Synmap& synmap, const std::string& filename);
+};
+
+#endif
@@ -4,15 +4,73 @@
 #include <vector>
 #include <Rcpp.h>
 
+#include "name_table.h"
+
 // Convert to 1-based position vector
 std::vector<long> to_one_base(std::vector<long> x);
 
+// Contigs are stored as interned ids (see NameTable) while rows are added and
+// are only turned into names when the table is converted to a data.frame.
+
+/** Receives the result rows of search, map and count queries
+ *
+ * The tables below collect rows for R, a ResultWriter streams them to a file.
+ * Each kind of row has its own add_row overload; a sink only implements the
+ * ones it expects, getting any other kind of row is an error.
+ */
+class ResultSink {
+public:
+    virtual ~ResultSink() { }
+
+    /** search row, see SIType */
+    virtual void add_row(
+        const std::string& t_seqname,
+        size_t      t_qcon,
+        long        t_qstart,
+        long        t_qstop,
+        size_t      t_tcon,
+        long        t_tstart,
+        long        t_tstop,
+        char        t_strand,
+        double      t_score,
+        size_t      t_cset,
+        int         t_l_flag,
+        int         t_r_flag,
+        bool        t_inbetween
+    )
+    {
+        Rcpp::stop("This result sink does not accept search results");
+    }
+
+    /** map row, see MapType */
+    virtual void add_row(
+        const std::string& t_seqname,
+        size_t      t_qcon,
+        long        t_qstart,
+        long        t_qstop,
+        size_t      t_tcon,
+        long        t_tstart,
+        long        t_tstop,
+        char        t_strand,
+        bool        t_missing
+    )
+    {
+        Rcpp::stop("This result sink does not accept map results");
+    }
+
+    /** count row, see CountType */
+    virtual void add_row(const std::string& t_seqname, int t_count)
+    {
+        Rcpp::stop("This result sink does not accept count results");
+    }
+};
+
 class DumpType {
 private:
-    std::vector<std::string> qcon;
+    std::vector<size_t>      qcon;
     std::vector<long>        qstart;
     std::vector<long>        qstop;
-    std::vector<std::string> tcon;
+    std::vector<size_t>      tcon;
     std::vector<long>        tstart;
     std::vector<long>        tstop;
     std::vector<double>      score;
@@ -21,10 +79,10 @@ private:
 
 public:
     void add_row(
-        std::string t_qcon,
+        size_t      t_qcon,
         long        t_qstart,
         long        t_qstop,
-        std::string t_tcon,
+        size_t      t_tcon,
         long        t_tstart,
         long        t_tstop,
         double      t_score,
@@ -43,12 +101,12 @@ public:
         cset.push_back   ( t_cset   );
     }
 
-    Rcpp::DataFrame as_data_frame() {
+    Rcpp::DataFrame as_data_frame(const NameTable& names) {
         return Rcpp::DataFrame::create(
-            Rcpp::Named("qseqid") = qcon,
+            Rcpp::Named("qseqid") = names.names(qcon),
             Rcpp::Named("qstart") = to_one_base(qstart),
             Rcpp::Named("qstop")  = to_one_base(qstop),
-            Rcpp::Named("tseqid") = tcon,
+            Rcpp::Named("tseqid") = names.names(tcon),
             Rcpp::Named("tstart") = to_one_base(tstart),
             Rcpp::Named("tstop")  = to_one_base(tstop),
             Rcpp::Named("score")  = score,
@@ -58,13 +116,15 @@ public:
     }
 };
 
-class CountType {
+class CountType : public ResultSink {
 private:
     std::vector<std::string> seqname;
     std::vector<int> count;
 
 public:
-    void add_row(std::string s, int c) {
+    using ResultSink::add_row;
+
+    void add_row(const std::string& s, int c) {
         seqname.push_back(s);
         count.push_back(c);
     }
@@ -80,25 +140,27 @@ public:
     }
 };
 
-class MapType {
+class MapType : public ResultSink {
 private:
     std::vector<std::string> seqname;
-    std::vector<std::string> qcon;
+    std::vector<size_t>      qcon;
     std::vector<long>        qstart;
     std::vector<long>        qstop;
-    std::vector<std::string> tcon;
+    std::vector<size_t>      tcon;
     std::vector<long>        tstart;
     std::vector<long>        tstop;
     std::vector<char>        strand;
     std::vector<bool>        missing;
 
 public:
+    using ResultSink::add_row;
+
     void add_row(
-        std::string t_seqname,
-        std::string t_qcon,
+        const std::string& t_seqname,
+        size_t      t_qcon,
         long        t_qstart,
         long        t_qstop,
-        std::string t_tcon,
+        size_t      t_tcon,
         long        t_tstart,
         long        t_tstop,
         char        t_strand,
@@ -116,13 +178,13 @@ public:
         missing.push_back ( t_missing );
     }
 
-    Rcpp::DataFrame as_data_frame() {
+    Rcpp::DataFrame as_data_frame(const NameTable& names) {
         return Rcpp::DataFrame::create(
             Rcpp::Named("attr")    = seqname,
-            Rcpp::Named("qseqid")  = qcon,
+            Rcpp::Named("qseqid")  = names.names(qcon),
             Rcpp::Named("qstart")  = to_one_base(qstart),
             Rcpp::Named("qstop")   = to_one_base(qstop),
-            Rcpp::Named("tseqid")  = tcon,
+            Rcpp::Named("tseqid")  = names.names(tcon),
             Rcpp::Named("tstart")  = to_one_base(tstart),
             Rcpp::Named("tstop")   = to_one_base(tstop),
             Rcpp::Named("strand")  = strand,
@@ -131,13 +193,13 @@ public:
     }
 };
 
-class SIType {
+class SIType : public ResultSink {
 private:
     std::vector<std::string> seqname;
-    std::vector<std::string> qcon;
+    std::vector<size_t>      qcon;
     std::vector<long>        qstart;
     std::vector<long>        qstop;
-    std::vector<std::string> tcon;
+    std::vector<size_t>      tcon;
     std::vector<long>        tstart;
     std::vector<long>        tstop;
     std::vector<char>        strand;
@@ -148,12 +210,14 @@ private:
     std::vector<bool>        inbetween;
 
 public:
+    using ResultSink::add_row;
+
     void add_row(
-        std::string t_seqname,
-        std::string t_qcon,
+        const std::string& t_seqname,
+        size_t      t_qcon,
         long        t_qstart,
         long        t_qstop,
-        std::string t_tcon,
+        size_t      t_tcon,
         long        t_tstart,
         long        t_tstop,
         char        t_strand,
@@ -179,13 +243,13 @@ public:
         inbetween.push_back ( t_inbetween );
     }
 
-    Rcpp::DataFrame as_data_frame() {
+    Rcpp::DataFrame as_data_frame(const NameTable& names) {
         return Rcpp::DataFrame::create(
             Rcpp::Named("attr")      = seqname,
-            Rcpp::Named("qseqid")    = qcon,
+            Rcpp::Named("qseqid")    = names.names(qcon),
             Rcpp::Named("qstart")    = to_one_base(qstart),
             Rcpp::Named("qstop")     = to_one_base(qstop),
-            Rcpp::Named("tseqid")    = tcon,
+            Rcpp::Named("tseqid")    = names.names(tcon),
             Rcpp::Named("tstart")    = to_one_base(tstart),
             Rcpp::Named("tstop")     = to_one_base(tstop),
             Rcpp::Named("strand")    = strand,
@@ -198,4 +262,116 @@ public:
     }
 };
 
+/** Holds result rows until they are passed on to another sink
+ *
+ * Queries running on many threads each fill their own buffer, no R API is
+ * called while rows are added. The buffers are then replayed in order into
+ * the real sink on the calling thread. Rows of each kind keep their order.
+ */
+class ResultBuffer : public ResultSink {
+private:
+    struct SearchRow {
+        std::string seqname;
+        size_t qcon;
+        long   qstart;
+        long   qstop;
+        size_t tcon;
+        long   tstart;
+        long   tstop;
+        char   strand;
+        double score;
+        size_t cset;
+        int    l_flag;
+        int    r_flag;
+        bool   inbetween;
+    };
+
+    struct MapRow {
+        std::string seqname;
+        size_t qcon;
+        long   qstart;
+        long   qstop;
+        size_t tcon;
+        long   tstart;
+        long   tstop;
+        char   strand;
+        bool   missing;
+    };
+
+    struct CountRow {
+        std::string seqname;
+        int count;
+    };
+
+    std::vector<SearchRow> search_rows;
+    std::vector<MapRow>    map_rows;
+    std::vector<CountRow>  count_rows;
+
+public:
+    void add_row(
+        const std::string& t_seqname,
+        size_t      t_qcon,
+        long        t_qstart,
+        long        t_qstop,
+        size_t      t_tcon,
+        long        t_tstart,
+        long        t_tstop,
+        char        t_strand,
+        double      t_score,
+        size_t      t_cset,
+        int         t_l_flag,
+        int         t_r_flag,
+        bool        t_inbetween
+    )
+    {
+        search_rows.push_back({
+            t_seqname, t_qcon, t_qstart, t_qstop, t_tcon, t_tstart, t_tstop,
+            t_strand, t_score, t_cset, t_l_flag, t_r_flag, t_inbetween
+        });
+    }
+
+    void add_row(
+        const std::string& t_seqname,
+        size_t      t_qcon,
+        long        t_qstart,
+        long        t_qstop,
+        size_t      t_tcon,
+        long        t_tstart,
+        long        t_tstop,
+        char        t_strand,
+        bool        t_missing
+    )
+    {
+        map_rows.push_back({
+            t_seqname, t_qcon, t_qstart, t_qstop, t_tcon, t_tstart, t_tstop,
+            t_strand, t_missing
+        });
+    }
+
+    void add_row(const std::string& t_seqname, int t_count)
+    {
+        count_rows.push_back({ t_seqname, t_count });
+    }
+
+    /** Pass every row on to out */
+    void replay(ResultSink& out) const
+    {
+        for (auto& x : search_rows) {
+            out.add_row(
+                x.seqname, x.qcon, x.qstart, x.qstop, x.tcon, x.tstart, x.tstop,
+                x.strand, x.score, x.cset, x.l_flag, x.r_flag, x.inbetween
+            );
+        }
+        for (auto& x : map_rows) {
+            out.add_row(
+                x.seqname, x.qcon, x.qstart, x.qstop, x.tcon, x.tstart, x.tstop,
+                x.strand, x.missing
+            );
+        }
+        for (auto& x : count_rows) {
+            out.add_row(x.seqname, x.count);
+        }
+    }
+};
+
 #endif